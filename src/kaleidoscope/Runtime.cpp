@@ -21,6 +21,8 @@
 namespace kaleidoscope {
 
 uint32_t Runtime_::millis_at_cycle_start_;
+bool Runtime_::phase_timing_;
+uint32_t Runtime_::phase_time_[Runtime_::cycle_phase_count];
 
 Runtime_::Runtime_(void) {
 }
@@ -51,14 +53,46 @@ Runtime_::loop(void) {
 
   kaleidoscope::Hooks::beforeEachCycle();
 
-  device().scanMatrix();
+  if (phase_timing_) {
+    loopTimed();
+  } else {
+    device().scanMatrix();
 
+    kaleidoscope::Hooks::beforeReportingState();
+
+    device().hid().keyboard().sendReport();
+    device().hid().keyboard().releaseAllKeys();
+  }
+
+  kaleidoscope::Hooks::afterEachCycle();
+
+  device().storage().sync();
+}
+
+void
+Runtime_::loopTimed(void) {
+  phase_time_[static_cast<uint8_t>(CyclePhase::LEDSync)] = 0;
+
+  // The same as scanMatrix(), split so that the key event handlers run by
+  // actOnMatrixScan() are counted with the other hooks, not with the scan.
+  uint32_t start = micros();
+  device().readMatrix();
+  uint32_t now = micros();
+  phase_time_[static_cast<uint8_t>(CyclePhase::Scan)] = now - start;
+
+  start = now;
+  device().actOnMatrixScan();
   kaleidoscope::Hooks::beforeReportingState();
+  now = micros();
+  // LEDControl adds the time it spends syncing LEDs, which happens during
+  // beforeReportingState(), to the LEDSync phase.
+  phase_time_[static_cast<uint8_t>(CyclePhase::Hooks)] =
+    now - start - phase_time_[static_cast<uint8_t>(CyclePhase::LEDSync)];
 
+  start = now;
   device().hid().keyboard().sendReport();
   device().hid().keyboard().releaseAllKeys();
-
-  kaleidoscope::Hooks::afterEachCycle();
+  phase_time_[static_cast<uint8_t>(CyclePhase::HIDSend)] = micros() - start;
 }
 
 Runtime_ Runtime;
@@ -128,8 +128,42 @@ class Runtime_ {
     return kaleidoscope::Hooks::onFocusEvent(command);
   }
 
+  /** Timing of the phases of a cycle.
+   *
+   * When enabled with `enablePhaseTiming()`, the main loop measures how long
+   * (in microseconds) each phase of the last cycle took. The scan phase only
+   * reads the matrix: the key event handlers it triggers are timed with the
+   * hooks. The LED sync happens from within the plugin hooks, and is reported
+   * on its own: the time of the hooks phase does not include it. Measuring costs a few `micros()` calls
+   * per cycle, so it is off by default.
+   */
+  enum class CyclePhase : uint8_t {
+    Scan,
+    Hooks,
+    HIDSend,
+    LEDSync,
+  };
+  static constexpr uint8_t cycle_phase_count = 4;
+
+  static void enablePhaseTiming(bool enabled = true) {
+    phase_timing_ = enabled;
+  }
+  static bool phaseTimingEnabled() {
+    return phase_timing_;
+  }
+  static uint32_t phaseTime(CyclePhase phase) {
+    return phase_time_[static_cast<uint8_t>(phase)];
+  }
+  static void addPhaseTime(CyclePhase phase, uint32_t time) {
+    phase_time_[static_cast<uint8_t>(phase)] += time;
+  }
+
  private:
   static uint32_t millis_at_cycle_start_;
+  static bool phase_timing_;
+  static uint32_t phase_time_[cycle_phase_count];
+
+  void loopTimed(void);
 };
 
 extern kaleidoscope::Runtime_ Runtime;
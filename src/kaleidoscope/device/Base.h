@@ -434,6 +434,7 @@ class Base {
    * Method to put the device into programmable/bootloader mode.
    */
   void rebootBootloader() {
+    storage_.compact();
     bootloader_.rebootBootloader();
   }
 
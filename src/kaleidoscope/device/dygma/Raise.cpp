@@ -31,6 +31,10 @@
 #define I2C_CLOCK_KHZ 200
 #define I2C_FLASH_CLOCK_KHZ 100 // flashing doesn't work reliably at higher clock speeds
 
+// Time it takes to send one LED bank: address, command, data and checksum, with
+// 9 clock cycles per byte.
+#define LED_BANK_TIME_US ((LED_BYTES_PER_BANK + 4) * 9 * 1000UL / I2C_CLOCK_KHZ)
+
 #define SIDE_POWER 1 // side power switch pa10
 
 #define LAYOUT_ISO 0
@@ -223,6 +227,14 @@ namespace kaleidoscope
 
       /********* LED Driver *********/
 
+      uint8_t RaiseLEDDriver::next_bank_;
+      uint16_t RaiseLEDDriver::budget_us_ = LED_BANK_TIME_US;
+      uint16_t RaiseLEDDriver::budget_left_us_;
+      uint16_t RaiseLEDDriver::priorityLeft;
+      uint16_t RaiseLEDDriver::priorityRight;
+      uint32_t RaiseLEDDriver::banks_sent_;
+      uint32_t RaiseLEDDriver::banks_deferred_;
+      uint32_t RaiseLEDDriver::frames_dropped_;
       bool RaiseLEDDriver::isLEDChangedNeuron;
       uint8_t RaiseLEDDriver::isLEDChangedLeft[LED_BANKS];
       uint8_t RaiseLEDDriver::isLEDChangedRight[LED_BANKS];
@@ -236,8 +248,8 @@ namespace kaleidoscope
         RaiseHands::ledBrightnessCorrection(brightness);
         for (uint8_t i = 0; i < LED_BANKS; i++)
         {
-          isLEDChangedLeft[i] = true;
-          isLEDChangedRight[i] = true;
+          isLEDChangedLeft[i] |= BANK_CHANGED;
+          isLEDChangedRight[i] |= BANK_CHANGED;
         }
       }
 
@@ -246,8 +258,8 @@ namespace kaleidoscope
         RaiseHands::ledBrightnessCorrectionUG(brightness);
         for (uint8_t i = 0; i < LED_BANKS; i++)
         {
-          isLEDChangedLeft[i] = true;
-          isLEDChangedRight[i] = true;
+          isLEDChangedLeft[i] |= BANK_CHANGED;
+          isLEDChangedRight[i] |= BANK_CHANGED;
         }
       }
 
@@ -263,29 +275,137 @@ namespace kaleidoscope
 
       void RaiseLEDDriver::syncLeds()
       {
-        // left and right sides
-        for (uint8_t i = 0; i < LED_BANKS; i++)
+        // Changes to a bank still waiting to be sent after this point replace
+        // a frame the side never got.
+        for (uint8_t bank = 0; bank < LED_BANKS; bank++)
+        {
+          if (isLEDChangedLeft[bank])
+            isLEDChangedLeft[bank] |= BANK_STALE;
+          if (isLEDChangedRight[bank])
+            isLEDChangedRight[bank] |= BANK_STALE;
+        }
+
+        // The banks of the sides are sent one at a time, in the background,
+        // between key scans - see startNextBank().
+        startNextBank();
+
+        if (isLEDChangedNeuron)
         {
-          // only send the banks that have changed - try to improve jitter performance
-          if (isLEDChangedLeft[i])
+          updateNeuronLED();
+          isLEDChangedNeuron = false;
+        }
+      }
+
+      // Called once per scan cycle, right after the keys were read: top up the
+      // I2C time budget, and start sending a bank if it allows.
+      //
+      // The budget is a token bucket that can hold up to one cycle's worth of
+      // time, or one bank, whichever is more. With a budget smaller than a bank,
+      // banks go out every few cycles instead; with a larger one, syncLeds() may
+      // send a second bank in the same cycle.
+      void RaiseLEDDriver::scheduleBanks()
+      {
+        uint16_t max_budget = budget_us_ > LED_BANK_TIME_US ? budget_us_ : LED_BANK_TIME_US;
+        if (budget_left_us_ < max_budget - budget_us_)
+          budget_left_us_ += budget_us_;
+        else
+          budget_left_us_ = max_budget;
+
+        startNextBank();
+      }
+
+      // Start sending the next changed LED bank, if there is one, and both the
+      // bus and the budget allow it. The transfer runs while the rest of the
+      // cycle is processed, so key scans only ever have to wait for a single
+      // bank, no matter how many of them changed.
+      //
+      // Banks under keys that toggled are sent first, the rest round-robin over
+      // both sides.
+      void RaiseLEDDriver::startNextBank()
+      {
+        for (uint8_t bank = 0; bank < LED_BANKS; bank++)
+        {
+          if (bitRead(priorityLeft, bank) && isLEDChangedLeft[bank])
           {
-            RaiseHands::leftHand.sendLEDBank(i);
-            isLEDChangedLeft[i] = false;
+            startBank(RaiseHands::leftHand, isLEDChangedLeft, priorityLeft, bank);
+            return;
           }
-          if (isLEDChangedRight[i])
+          if (bitRead(priorityRight, bank) && isLEDChangedRight[bank])
           {
-            RaiseHands::rightHand.sendLEDBank(i);
-            isLEDChangedRight[i] = false;
+            startBank(RaiseHands::rightHand, isLEDChangedRight, priorityRight, bank);
+            return;
           }
         }
 
-        if (isLEDChangedNeuron)
+        for (uint8_t n = 0; n < LED_BANKS * 2; n++)
         {
-          updateNeuronLED();
-          isLEDChangedNeuron = false;
+          uint8_t bank = next_bank_++;
+          if (next_bank_ >= LED_BANKS * 2)
+            next_bank_ = 0;
+
+          if (bank < LED_BANKS)
+          {
+            if (!isLEDChangedLeft[bank])
+              continue;
+            if (!startBank(RaiseHands::leftHand, isLEDChangedLeft, priorityLeft, bank))
+              next_bank_ = bank;
+          }
+          else
+          {
+            bank -= LED_BANKS;
+            if (!isLEDChangedRight[bank])
+              continue;
+            if (!startBank(RaiseHands::rightHand, isLEDChangedRight, priorityRight, bank))
+              next_bank_ = bank + LED_BANKS;
+          }
+          return;
         }
       }
 
+      bool RaiseLEDDriver::startBank(raise::Hand &hand, uint8_t *isLEDChanged,
+                                     uint16_t &priority, uint8_t bank)
+      {
+        if (budget_left_us_ < LED_BANK_TIME_US || !hand.startLEDBank(bank))
+        {
+          // Each bank counts once, however many cycles it has to wait.
+          if (!(isLEDChanged[bank] & BANK_DEFERRED))
+            banks_deferred_++;
+          isLEDChanged[bank] |= BANK_DEFERRED;
+          return false;
+        }
+
+        budget_left_us_ -= LED_BANK_TIME_US;
+        isLEDChanged[bank] = 0;
+        bitClear(priority, bank);
+        banks_sent_++;
+        return true;
+      }
+
+      // Mark a bank as changed. If it was still waiting to be sent from an
+      // earlier frame, that frame of it never reaches the side: the two are
+      // coalesced into one, and counted as a dropped frame once, not for every
+      // LED written.
+      void RaiseLEDDriver::markChanged(uint8_t *isLEDChanged, uint8_t bank, bool changed)
+      {
+        if (!changed)
+          return;
+        if (isLEDChanged[bank] & BANK_STALE)
+          frames_dropped_++;
+        isLEDChanged[bank] = (isLEDChanged[bank] & BANK_DEFERRED) | BANK_CHANGED;
+      }
+
+      void RaiseLEDDriver::prioritizeLed(uint8_t led_index)
+      {
+        if (led_index >= RaiseLEDDriverProps::led_count - 1)
+          return;
+
+        uint8_t sled_num = led_map[RaiseHands::layout][led_index];
+        if (sled_num < LEDS_PER_HAND)
+          bitSet(priorityLeft, sled_num / 8);
+        else if (sled_num < 2 * LEDS_PER_HAND)
+          bitSet(priorityRight, (sled_num - LEDS_PER_HAND) / 8);
+      }
+
       void RaiseLEDDriver::updateNeuronLED()
       {
         static constexpr struct
@@ -322,16 +442,16 @@ namespace kaleidoscope
         {
           cRGB oldColor = RaiseHands::leftHand.led_data.leds[sled_num];
           RaiseHands::leftHand.led_data.leds[sled_num] = crgb;
-          isLEDChangedLeft[uint8_t(sled_num / 8)] |=
-              !(oldColor.r == crgb.r && oldColor.g == crgb.g && oldColor.b == crgb.b);
+          markChanged(isLEDChangedLeft, sled_num / 8,
+                      !(oldColor.r == crgb.r && oldColor.g == crgb.g && oldColor.b == crgb.b));
         }
         else if (sled_num < 2 * LEDS_PER_HAND)
         {
           cRGB oldColor =
               RaiseHands::rightHand.led_data.leds[sled_num - LEDS_PER_HAND];
           RaiseHands::rightHand.led_data.leds[sled_num - LEDS_PER_HAND] = crgb;
-          isLEDChangedRight[uint8_t((sled_num - LEDS_PER_HAND) / 8)] |=
-              !(oldColor.r == crgb.r && oldColor.g == crgb.g && oldColor.b == crgb.b);
+          markChanged(isLEDChangedRight, (sled_num - LEDS_PER_HAND) / 8,
+                      !(oldColor.r == crgb.r && oldColor.g == crgb.g && oldColor.b == crgb.b));
         }
         else
         {
@@ -440,12 +560,24 @@ namespace kaleidoscope
         // store previous state of whether the sides are plugged in
         lastLeftOnline = RaiseHands::leftHand.online;
         lastRightOnline = RaiseHands::rightHand.online;
+
+        // the keys are read, the bus is ours until the next scan
+        RaiseLEDDriver::scheduleBanks();
       }
 
       void RaiseKeyScanner::actOnMatrixScan()
       {
+        uint64_t active = previousLeftHandState.all | leftHandState.all |
+                          previousRightHandState.all | rightHandState.all;
+
         for (byte row = 0; row < Props_::matrix_rows; row++)
         {
+          // A row where no key on either side is down, or was down on the
+          // previous scan, has no events to report.
+          if (((active >> (row * Props_::left_columns)) &
+               ((1 << Props_::left_columns) - 1)) == 0)
+            continue;
+
           for (byte col = 0; col < Props_::left_columns; col++)
           {
             uint8_t keynum = (row * Props_::left_columns) + col;
@@ -456,6 +588,9 @@ namespace kaleidoscope
                        (bitRead(leftHandState.all, keynum) << 1);
             if (keyState)
               ThisType::handleKeyswitchEvent(Key_NoKey, KeyAddr(row, col), keyState);
+            if (keyState == WAS_PRESSED || keyState == IS_PRESSED)
+              RaiseLEDDriver::prioritizeLed(
+                  RaiseLEDDriver::getLedIndex(KeyAddr(row, col).toInt()));
 
             // right
             keyState = (bitRead(previousRightHandState.all, keynum) << 0) |
@@ -464,6 +599,9 @@ namespace kaleidoscope
               ThisType::handleKeyswitchEvent(
                   Key_NoKey, KeyAddr(row, (Props_::matrix_columns - 1) - col),
                   keyState);
+            if (keyState == WAS_PRESSED || keyState == IS_PRESSED)
+              RaiseLEDDriver::prioritizeLed(RaiseLEDDriver::getLedIndex(
+                  KeyAddr(row, (Props_::matrix_columns - 1) - col).toInt()));
           }
         }
       }
@@ -618,12 +756,14 @@ namespace kaleidoscope
         // static object intialisation ordering
         Wire.begin();
         Wire.setClock(I2C_CLOCK_KHZ * 1000);
+        raise::TWI::setupDMA();
 
         RaiseHands::initializeSides();
       }
 
       void Raise::side::prepareForFlash()
       {
+        raise::TWI::waitForIdle();
         Wire.end();
 
         setPower(LOW);
@@ -689,6 +829,19 @@ namespace kaleidoscope
         RaiseHands::leftHand.setSLEDCurrent(current);
       }
 
+      uint32_t Raise::side::ledBanksSent()
+      {
+        return RaiseLEDDriver::banksSent();
+      }
+      uint32_t Raise::side::ledBanksDeferred()
+      {
+        return RaiseLEDDriver::banksDeferred();
+      }
+      uint32_t Raise::side::ledFramesDropped()
+      {
+        return RaiseLEDDriver::framesDropped();
+      }
+
       Raise::settings::Layout Raise::settings::layout()
       {
         return RaiseHands::layout == LAYOUT_ANSI ? Layout::ANSI : Layout::ISO;
@@ -708,6 +861,15 @@ namespace kaleidoscope
         RaiseHands::keyscanInterval(interval);
       }
 
+      uint16_t Raise::settings::ledBudget()
+      {
+        return RaiseLEDDriver::budget();
+      }
+      void Raise::settings::ledBudget(uint16_t budget)
+      {
+        RaiseLEDDriver::budget(budget);
+      }
+
     } // namespace dygma
   } // namespace device
 } // namespace kaleidoscope
@@ -73,7 +73,51 @@ namespace kaleidoscope
 
         static void updateNeuronLED();
 
+        /* Bank scheduling
+         *
+         * Changed LED banks are sent to the sides one at a time, in the
+         * background, at most as many per scan cycle as the I2C time budget
+         * (in microseconds) allows. Banks under keys that just toggled are sent
+         * first. A budget of 0 stops sending LED updates to the sides.
+         *
+         * banksDeferred() counts the banks that had to wait for a later cycle,
+         * once each, and framesDropped() the frames of a bank that were
+         * overwritten by a later one before they could be sent.
+         */
+        static void scheduleBanks();
+        static void startNextBank();
+        static void prioritizeLed(uint8_t led_index);
+
+        static uint16_t budget() { return budget_us_; }
+        static void budget(uint16_t budget_us) { budget_us_ = budget_us; }
+
+        static uint32_t banksSent() { return banks_sent_; }
+        static uint32_t banksDeferred() { return banks_deferred_; }
+        static uint32_t framesDropped() { return frames_dropped_; }
+
       private:
+        static uint8_t next_bank_;
+        static uint16_t budget_us_;
+        static uint16_t budget_left_us_;
+        static uint16_t priorityLeft;
+        static uint16_t priorityRight;
+        static uint32_t banks_sent_;
+        static uint32_t banks_deferred_;
+        static uint32_t frames_dropped_;
+
+        static bool startBank(raise::Hand &hand, uint8_t *isLEDChanged,
+                              uint16_t &priority, uint8_t bank);
+        static void markChanged(uint8_t *isLEDChanged, uint8_t bank, bool changed);
+
+        // The state of each bank in isLEDChangedLeft/Right: zero when the side
+        // has the bank as it is, otherwise BANK_CHANGED, plus any of the other
+        // flags, which only serve the stats.
+        enum : uint8_t {
+          BANK_CHANGED = 1 << 0,  // needs to be sent
+          BANK_STALE = 1 << 1,    // the LEDs were synced since it changed
+          BANK_DEFERRED = 1 << 2, // counted in banks_deferred_ already
+        };
+
         static bool isLEDChangedNeuron;
         static uint8_t isLEDChangedLeft[LED_BANKS];
         static uint8_t isLEDChangedRight[LED_BANKS];
@@ -227,6 +271,10 @@ namespace kaleidoscope
 
           void prepareForFlash();
 
+          uint32_t ledBanksSent();
+          uint32_t ledBanksDeferred();
+          uint32_t ledFramesDropped();
+
           // Side bootloader addresses
           static constexpr uint8_t left_boot_address = 0x50;
           static constexpr uint8_t right_boot_address = 0x51;
@@ -244,6 +292,8 @@ namespace kaleidoscope
 
           uint16_t keyscanInterval();
           void keyscanInterval(uint16_t interval);
+          uint16_t ledBudget();
+          void ledBudget(uint16_t budget);
           String getChipID();
         } settings;
       };
@@ -32,7 +32,7 @@ namespace raise {
 #endif
 
 EventHandlerResult Focus::onFocusEvent(const char *command) {
-  if (::Focus.handleHelp(command, PSTR("hardware.version\nhardware.side_power\nhardware.side_ver\nhardware.sled_ver\nhardware.sled_current\nhardware.layout\nhardware.joint\nhardware.keyscan\nhardware.crc_errors\nhardware.firmware\nhardware.chip_id")))
+  if (::Focus.handleHelp(command, PSTR("hardware.version\nhardware.side_power\nhardware.side_ver\nhardware.sled_ver\nhardware.sled_current\nhardware.layout\nhardware.joint\nhardware.keyscan\nhardware.led_budget\nhardware.led_stats\nhardware.crc_errors\nhardware.firmware\nhardware.chip_id")))
     return EventHandlerResult::OK;
 
   if (strncmp_P(command, PSTR("hardware."), 9) != 0)
@@ -127,6 +127,28 @@ EventHandlerResult Focus::onFocusEvent(const char *command) {
     }
   }
 
+  if (strcmp_P(command + 9, PSTR("led_budget")) == 0) {
+    if (::Focus.isEOL()) {
+      ::Focus.send(Runtime.device().settings.ledBudget());
+      return EventHandlerResult::EVENT_CONSUMED;
+    } else {
+      uint16_t budget;
+      ::Focus.read(budget);
+      Runtime.device().settings.ledBudget(budget);
+      return EventHandlerResult::EVENT_CONSUMED;
+    }
+  }
+
+  if (strcmp_P(command + 9, PSTR("led_stats")) == 0) {
+    ::Focus.send("sent:");
+    ::Focus.send(Runtime.device().side.ledBanksSent());
+    ::Focus.send("\ndeferred:");
+    ::Focus.send(Runtime.device().side.ledBanksDeferred());
+    ::Focus.send("\ndropped:");
+    ::Focus.send(Runtime.device().side.ledFramesDropped());
+    return EventHandlerResult::EVENT_CONSUMED;
+  }
+
   return EventHandlerResult::OK;
 }
 
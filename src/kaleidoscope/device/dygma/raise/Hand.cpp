@@ -248,43 +248,68 @@ namespace kaleidoscope
 
         auto constexpr gamma8 = kaleidoscope::driver::color::gamma_correction;
 
-        void Hand::sendLEDBank(uint8_t bank)
+        void Hand::buildColorLUT()
         {
-          uint8_t data[LED_BYTES_PER_BANK + 1]; // + 1 for the update LED command itself
-          data[0] = TWI_CMD_LED_BASE + bank;
-          for (uint8_t i = 0; i < LED_BYTES_PER_BANK; i++)
+          for (uint16_t c = 0; c < 256; c++)
           {
-            uint8_t c = led_data.bytes[bank][i];
-            if (bank < 4 || (bank == 4 && i < 6) || (bank > 7 && i > 5))
-            {
-              if (c > brightness_adjustment_)
-                c -= brightness_adjustment_;
-              else
-                c = 0;
-            }
-            else
-            {
-              if (c > brightness_adjustment_ug_)
-                c -= brightness_adjustment_ug_;
-              else
-                c = 0;
-            }
-
-            data[i + 1] = pgm_read_byte(&gamma8[c]);
+            uint8_t keys = c > brightness_adjustment_ ? c - brightness_adjustment_ : 0;
+            uint8_t underglow = c > brightness_adjustment_ug_ ? c - brightness_adjustment_ug_ : 0;
+
+            keys = pgm_read_byte(&gamma8[keys]);
+            underglow = pgm_read_byte(&gamma8[underglow]);
+
+            color_lut_[KEYS][c] = keys;
+            color_lut_[UNDERGLOW][c] = underglow;
 
             // The Red component on the Raise hardware appears to get more voltage than
             // the others, resulting in colors slightly off. Adjust for that here by
             // reducing the red component a little.
             //
             // FIXME(@anyone): This should eventually be configurable someway.
-            if ((i + 1) % 3 == 1)
-            {
-              data[i + 1] = data[i + 1] * red_max_fraction_ / 100;
-            }
+            color_lut_[KEYS_RED][c] = keys * red_max_fraction_ / 100;
+            color_lut_[UNDERGLOW_RED][c] = underglow * red_max_fraction_ / 100;
+          }
+          color_lut_dirty_ = false;
+        }
+
+        void Hand::prepareLEDBank(uint8_t bank, uint8_t *data)
+        {
+          if (color_lut_dirty_)
+            buildColorLUT();
+
+          data[0] = TWI_CMD_LED_BASE + bank;
+          for (uint8_t i = 0; i < LED_BYTES_PER_BANK; i += sizeof(cRGB))
+          {
+            const byte *c = &led_data.bytes[bank][i];
+            bool keys = bank < 4 || (bank == 4 && i < 6) || (bank > 7 && i > 5);
+            const uint8_t *lut = color_lut_[keys ? KEYS : UNDERGLOW];
+            const uint8_t *red_lut = color_lut_[keys ? KEYS_RED : UNDERGLOW_RED];
+
+            data[i + 1] = red_lut[c[0]];
+            data[i + 2] = lut[c[1]];
+            data[i + 3] = lut[c[2]];
           }
+        }
+
+        void Hand::sendLEDBank(uint8_t bank)
+        {
+          uint8_t data[LED_BYTES_PER_BANK + 1]; // + 1 for the update LED command itself
+          prepareLEDBank(bank, data);
           uint8_t result = twi_.writeTo(data, ELEMENTS(data));
         }
 
+        // Same as sendLEDBank(), but returns as soon as the transfer started,
+        // without waiting for it to finish. Returns false if the bus is busy.
+        bool Hand::startLEDBank(uint8_t bank)
+        {
+          if (TWI::busy())
+            return false;
+
+          uint8_t data[LED_BYTES_PER_BANK + 1]; // + 1 for the update LED command itself
+          prepareLEDBank(bank, data);
+          return twi_.startWriteTo(data, ELEMENTS(data));
+        }
+
       }
     }
   }
@@ -84,6 +84,7 @@ namespace kaleidoscope
           bool moreKeysWaiting();
           void sendLEDData();
           void sendLEDBank(uint8_t bank);
+          bool startLEDBank(uint8_t bank);
           keydata_t getKeyData();
           bool readKeys();
           uint8_t controllerAddress();
@@ -95,6 +96,7 @@ namespace kaleidoscope
           void setBrightness(uint8_t brightness)
           {
             brightness_adjustment_ = 255 - brightness;
+            color_lut_dirty_ = true;
           }
           uint8_t getBrightness()
           {
@@ -104,6 +106,7 @@ namespace kaleidoscope
           void setBrightnessUG(uint8_t brightness)
           {
             brightness_adjustment_ug_ = 255 - brightness;
+            color_lut_dirty_ = true;
           }
           uint8_t getBrightnessUG()
           {
@@ -122,9 +125,26 @@ namespace kaleidoscope
           uint8_t next_led_bank_ = 0;
           uint8_t red_max_fraction_ = (LED_RED_CHANNEL_MAX * 100) / 255;
 
+          // The brightness adjustment, gamma correction and red channel
+          // scaling of every byte value, for the key LEDs and the underglow,
+          // for the red channel and the others. Rebuilt when the brightness
+          // changes, so sending a bank is a single lookup per byte.
+          enum ColorLUT : uint8_t
+          {
+            KEYS,
+            KEYS_RED,
+            UNDERGLOW,
+            UNDERGLOW_RED,
+            COLOR_LUT_COUNT
+          };
+          uint8_t color_lut_[COLOR_LUT_COUNT][256];
+          bool color_lut_dirty_ = true;
+
           static constexpr uint8_t i2c_addr_base_ = 0x58;
 
           int readRegister(uint8_t cmd);
+          void prepareLEDBank(uint8_t bank, uint8_t *data);
+          void buildColorLUT();
         };
 
       }
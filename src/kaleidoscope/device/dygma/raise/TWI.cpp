@@ -23,12 +23,166 @@
 #include "TWI.h"
 #include "kaleidoscope/util/crc16.h"
 
+#define ELEMENTS(arr) (sizeof(arr) / sizeof((arr)[0]))
+
 namespace kaleidoscope {
 namespace device {
 namespace dygma {
 namespace raise {
 
+// Asynchronous writes use a single DMA channel to feed the SERCOM the Wire
+// library is attached to. With the SERCOM's length counter enabled
+// (ADDR.LENEN), the hardware sends the STOP condition on its own, so a write
+// needs no attention from the CPU until it is complete.
+#define TWI_DMA_CHANNEL 0
+
+// The longest asynchronous write we do is an LED bank: 28 bytes including the
+// address and the checksum, about 1.3ms at 200kHz. Anything taking much longer
+// than that means the bus is stuck.
+#define TWI_TRANSFER_TIMEOUT_US 5000
+
+#define TWI_BUSSTATE_IDLE 1
+#define TWI_BUSSTATE_OWNER 2
+#define TWI_CMD_STOP 3
+
+// The descriptor tables the DMA controller uses when nothing else set it up
+// before us, and our channel's descriptor, in whichever table it uses.
+static DmacDescriptor dma_descriptors_[TWI_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+static DmacDescriptor dma_writeback_[TWI_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+static DmacDescriptor *dma_descriptor_;
+static Sercom *sercom_;
+static uint8_t dma_trigger_tx_;
+
+uint8_t TWI::buffer_[TWI::max_transfer_length];
+bool TWI::active_;
+uint32_t TWI::transfer_started_at_;
+
+void TWI::setupDMA() {
+  if (dma_descriptor_ != nullptr)
+    return;
+
+  // Find the SERCOM instance Wire is using, so we can talk to its registers
+  // directly.
+  SERCOM *wire_sercoms[] = {&sercom0, &sercom1, &sercom2, &sercom3, &sercom4, &sercom5};
+  Sercom *sercoms[] = SERCOM_INSTS;
+
+  for (uint8_t i = 0; i < ELEMENTS(wire_sercoms); i++) {
+    if (&PERIPH_WIRE == wire_sercoms[i]) {
+      sercom_ = sercoms[i];
+      dma_trigger_tx_ = SERCOM0_DMAC_ID_TX + i * 2;
+    }
+  }
+
+  PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+  PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+
+  // Other code may already be using the DMA controller: rather than resetting
+  // it under them, share their descriptor table. Our channel is reset on its
+  // own before every write.
+  if (DMAC->CTRL.bit.DMAENABLE) {
+    dma_descriptor_ = (DmacDescriptor *)DMAC->BASEADDR.reg + TWI_DMA_CHANNEL;
+  } else {
+    DMAC->BASEADDR.reg = (uint32_t)dma_descriptors_;
+    DMAC->WRBADDR.reg = (uint32_t)dma_writeback_;
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xf);
+    dma_descriptor_ = &dma_descriptors_[TWI_DMA_CHANNEL];
+  }
+}
+
+bool TWI::startWriteTo(const uint8_t *data, size_t length) {
+  if (sercom_ == nullptr || dma_descriptor_ == nullptr ||
+      length + 2 > max_transfer_length || busy())
+    return false;
+
+  uint8_t bus_state = sercom_->I2CM.STATUS.bit.BUSSTATE;
+  if (bus_state != TWI_BUSSTATE_IDLE && bus_state != TWI_BUSSTATE_OWNER)
+    return false;
+
+  // calc cksum
+  uint16_t crc16 = 0xffff;
+  for (uint8_t i = 0; i < length; i++) {
+    buffer_[i] = data[i];
+    crc16 = _crc_ccitt_update(crc16, data[i]);
+  }
+  buffer_[length] = crc16 >> 8;
+  buffer_[length + 1] = crc16;
+  length += 2;
+
+  DMAC->CHID.reg = DMAC_CHID_ID(TWI_DMA_CHANNEL);
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+  DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+  while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_SWRST) {}
+  DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) |
+                      DMAC_CHCTRLB_TRIGSRC(dma_trigger_tx_) |
+                      DMAC_CHCTRLB_TRIGACT_BEAT;
+
+  // With source address incrementing enabled, the DMA controller wants the
+  // address one past the end of the block.
+  dma_descriptor_->BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_BYTE |
+                                DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_BLOCKACT_NOACT;
+  dma_descriptor_->SRCADDR.reg = (uint32_t)buffer_ + length;
+  dma_descriptor_->DSTADDR.reg = (uint32_t)&sercom_->I2CM.DATA.reg;
+  dma_descriptor_->BTCNT.reg = length;
+  dma_descriptor_->DESCADDR.reg = 0;
+
+  DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_MASK;
+  DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+
+  active_ = true;
+  transfer_started_at_ = micros();
+
+  sercom_->I2CM.ADDR.reg = SERCOM_I2CM_ADDR_ADDR(addr_ << 1) |
+                           SERCOM_I2CM_ADDR_LENEN |
+                           SERCOM_I2CM_ADDR_LEN(length);
+  while (sercom_->I2CM.SYNCBUSY.bit.SYSOP) {}
+
+  return true;
+}
+
+bool TWI::busy() {
+  if (!active_)
+    return false;
+
+  // Bus errors, lost arbitration, or the hand not acknowledging (it is
+  // probably unplugged).
+  if (sercom_->I2CM.INTFLAG.bit.ERROR ||
+      (sercom_->I2CM.INTFLAG.bit.MB && sercom_->I2CM.STATUS.bit.RXNACK)) {
+    abortTransfer();
+    return false;
+  }
+
+  DMAC->CHID.reg = DMAC_CHID_ID(TWI_DMA_CHANNEL);
+  if (DMAC->CHINTFLAG.bit.TCMPL &&
+      sercom_->I2CM.STATUS.bit.BUSSTATE == TWI_BUSSTATE_IDLE) {
+    active_ = false;
+    return false;
+  }
+
+  if (micros() - transfer_started_at_ > TWI_TRANSFER_TIMEOUT_US) {
+    abortTransfer();
+    return false;
+  }
+
+  return true;
+}
+
+void TWI::waitForIdle() {
+  while (busy()) {}
+}
+
+void TWI::abortTransfer() {
+  DMAC->CHID.reg = DMAC_CHID_ID(TWI_DMA_CHANNEL);
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+
+  sercom_->I2CM.CTRLB.bit.CMD = TWI_CMD_STOP;
+  while (sercom_->I2CM.SYNCBUSY.bit.SYSOP) {}
+
+  active_ = false;
+}
+
 uint8_t TWI::writeTo(uint8_t *data, size_t length) {
+  waitForIdle();
+
   Wire.beginTransmission(addr_);
 
   // calc cksum
@@ -55,6 +209,8 @@ uint8_t TWI::readFrom(uint8_t* data, size_t length) {
   uint32_t timeout;
   uint8_t *buffer = data;
 
+  waitForIdle();
+
   if (!Wire.requestFrom(addr_, length + 2, true)) { // + 2 for the cksum
     // in case slave is not responding - return 0 (0 length of received data).
     recovery();
@@ -40,10 +40,35 @@ class TWI {
     return crc_errors_;
   }
 
+  /* Asynchronous writes
+   *
+   * Both hands share a single bus, and only one asynchronous write can be in
+   * flight on it at any time. The write is driven by DMA, so `startWriteTo`
+   * returns as soon as it started, and the bus is free again once `busy()`
+   * returns false. `startWriteTo` returns false without doing anything if the
+   * bus is busy.
+   *
+   * The blocking `writeTo` and `readFrom` wait for an in-flight write to
+   * finish before they touch the bus.
+   */
+  static constexpr uint8_t max_transfer_length = 32;
+
+  bool startWriteTo(const uint8_t *data, size_t length);
+
+  static void setupDMA();
+  static bool busy();
+  static void waitForIdle();
+
  private:
   int addr_;
   uint8_t crc_errors_;
   uint16_t clock_khz_;
+
+  static uint8_t buffer_[max_transfer_length];
+  static bool active_;
+  static uint32_t transfer_started_at_;
+
+  static void abortTransfer();
 };
 
 }
@@ -95,6 +95,9 @@ void __attribute__((optimize(3))) ErgoDox::readMatrixRow(uint8_t row) {
 }
 
 void __attribute__((optimize(3))) ErgoDox::readMatrix() {
+  // We only want to update our matrix if the timer has expired.
+  if (!do_scan_)
+    return;
   do_scan_ = false;
 
   scanner_.reattachExpanderOnError();
@@ -112,22 +115,23 @@ void __attribute__((optimize(3))) ErgoDox::readMatrix() {
 
 void __attribute__((optimize(3))) ErgoDox::actOnMatrixScan() {
   for (byte row = 0; row < matrix_rows; row++) {
-    for (byte col = 0; col < matrix_columns; col++) {
-      uint8_t keyState = (bitRead(previousKeyState_[row], col) << 0) |
-                         (bitRead(keyState_[row], col) << 1);
+    uint8_t current = keyState_[row];
+    uint8_t previous = previousKeyState_[row];
+
+    // Stop at the first column past which every key is idle.
+    for (byte col = 0; (current | previous) != 0; col++) {
+      uint8_t keyState = ((previous & 1) << 0) | ((current & 1) << 1);
       if (keyState)
         handleKeyswitchEvent(Key_NoKey, KeyAddr(row, col), keyState);
+      current >>= 1;
+      previous >>= 1;
     }
     previousKeyState_[row] = keyState_[row];
   }
 }
 
 void ErgoDox::scanMatrix() {
-  if (do_scan_) {
-    do_scan_ = false;
-    // We only want to update our matrix if the timer has expired.
-    readMatrix();
-  }
+  readMatrix();
 
   // We ALWAYS want to tell Kaleidoscope about the state of the matrix
   actOnMatrixScan();
@@ -169,18 +169,18 @@ void Model01KeyScanner::readMatrix() {
 }
 
 void Model01KeyScanner::actOnHalfRow(byte row, byte colState, byte colPrevState, byte startPos) {
-  if ((colState != colPrevState) || (colState != 0)) {
-    for (byte col = 0; col < 8; col++) {
-      // Build up the key state for row, col
-      uint8_t keyState = ((bitRead(colPrevState, 0) << 0) |
-                          (bitRead(colState,     0) << 1));
-      if (keyState)
-        ThisType::handleKeyswitchEvent(Key_NoKey, KeyAddr(row, startPos - col), keyState);
-
-      // Throw away the data we've just used, so we can read the next column
-      colState = colState >> 1;
-      colPrevState = colPrevState >> 1;
-    }
+  // Once no key in the rest of the half row is down or was down on the last
+  // scan, there are no more events to report.
+  for (byte col = 0; (colState | colPrevState) != 0; col++) {
+    // Build up the key state for row, col
+    uint8_t keyState = ((bitRead(colPrevState, 0) << 0) |
+                        (bitRead(colState,     0) << 1));
+    if (keyState)
+      ThisType::handleKeyswitchEvent(Key_NoKey, KeyAddr(row, startPos - col), keyState);
+
+    // Throw away the data we've just used, so we can read the next column
+    colState = colState >> 1;
+    colPrevState = colPrevState >> 1;
   }
 }
 
@@ -25,6 +25,7 @@
 #include "kaleidoscope/MatrixAddr.h"
 #include "kaleidoscope/key_defs.h"
 #include "kaleidoscope/key_events.h"
+#include "kaleidoscope/Runtime.h"
 
 
 #include "HIDReportObserver.h"
@@ -33,6 +34,11 @@
 
 #include <sstream>
 #include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // FIXME: This relates to virtual/cores/arduino/EEPROM.h.
 //        EEPROM static data must be defined here as only
@@ -62,7 +68,12 @@ using namespace kaleidoscope::logging; // NOLINT(build/namespaces)
 VirtualKeyScanner::VirtualKeyScanner()
   :  n_pressed_switches_{0},
      n_previously_pressed_switches_{0},
-     read_matrix_enabled_{true} {
+     read_matrix_enabled_{true},
+     trace_reader_{nullptr, 0},
+     trace_record_pending_{false},
+     trace_time_{0},
+     trace_mapping_{nullptr},
+     trace_mapping_size_{0} {
 }
 
 void VirtualKeyScanner::setup() {
@@ -74,6 +85,91 @@ void VirtualKeyScanner::setup() {
     keystates_prev_[key_addr.toInt()] = KeyState::NotPressed;
     mask_[key_addr.toInt()] = false;
   }
+
+  const char *trace = getenv("KALEIDOSCOPE_KEY_TRACE");
+  if (trace)
+    replayTrace(trace);
+}
+
+bool VirtualKeyScanner::replayTrace(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    log_error("Cannot open key trace: %s\n", path);
+    return false;
+  }
+
+  struct stat st;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+    mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    log_error("Cannot map key trace: %s\n", path);
+    return false;
+  }
+
+  if (!replayTrace(static_cast<const uint8_t *>(mapping), st.st_size)) {
+    log_error("Cannot replay key trace: %s\n", path);
+    munmap(mapping, st.st_size);
+    return false;
+  }
+
+  trace_mapping_ = mapping;
+  trace_mapping_size_ = st.st_size;
+  return true;
+}
+
+bool VirtualKeyScanner::replayTrace(const uint8_t *data, size_t size) {
+  if (!key_trace::isValidHeader(data, size)) {
+    log_error("Not a key trace\n");
+    return false;
+  }
+  if (key_trace::keyCount(data) != KeyAddr::upper_limit) {
+    log_error("Key trace recorded with %d keys, this device has %d\n",
+              key_trace::keyCount(data), static_cast<int>(KeyAddr::upper_limit));
+    return false;
+  }
+
+  unmapTrace();
+  trace_reader_ = key_trace::Reader(data, size);
+  trace_record_pending_ = false;
+  trace_time_ = Runtime.millisAtCycleStart();
+  return true;
+}
+
+void VirtualKeyScanner::unmapTrace() {
+  if (trace_mapping_ != nullptr)
+    munmap(trace_mapping_, trace_mapping_size_);
+  trace_mapping_ = nullptr;
+  trace_mapping_size_ = 0;
+}
+
+void VirtualKeyScanner::replayTraceRecords() {
+  uint32_t now = Runtime.millisAtCycleStart();
+
+  while (true) {
+    if (!trace_record_pending_) {
+      if (trace_reader_.done()) {
+        unmapTrace();
+        return;
+      }
+      trace_record_ = trace_reader_.read();
+      trace_time_ += trace_record_.delta;
+      trace_record_pending_ = true;
+    }
+
+    // Records that are not due yet wait for a later scan.
+    if (static_cast<int32_t>(now - trace_time_) < 0)
+      return;
+
+    KeyAddr key_addr(trace_record_.key);
+    if (trace_record_.key != key_trace::idle_key && key_addr.isValid()) {
+      keystates_[key_addr.toInt()] =
+        trace_record_.pressed ? KeyState::Pressed : KeyState::NotPressed;
+    }
+    trace_record_pending_ = false;
+  }
 }
 
 enum Mode {
@@ -159,6 +255,11 @@ void VirtualKeyScanner::readMatrix() {
 
   if (!read_matrix_enabled_) return;
 
+  if (replayingTrace()) {
+    replayTraceRecords();
+    return;
+  }
+
   std::stringstream sline;
   sline << getLineOfInput(anythingHeld());
   Mode mode = M_TAP;
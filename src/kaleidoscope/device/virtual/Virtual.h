@@ -23,6 +23,7 @@
 
 #include "kaleidoscope/driver/bootloader/None.h"
 #include "kaleidoscope/driver/led/Base.h"
+#include "kaleidoscope/key_trace.h"
 
 namespace kaleidoscope {
 namespace device {
@@ -75,9 +76,26 @@ class VirtualKeyScanner
   void setKeystate(KeyAddr keyAddr, KeyState ks);
   KeyState getKeystate(KeyAddr keyAddr) const;
 
+  // Replays a binary key event trace (see kaleidoscope/key_trace.h) instead of
+  // reading commands from the input, starting with the next scan. The file is
+  // mapped into memory and read in place; the data passed to the second form
+  // must outlive the replay. Once the trace is over, input is read again.
+  // Traces recorded on a device with a different number of keys are refused,
+  // and both forms return whether the replay started.
+  //
+  // Setting the KALEIDOSCOPE_KEY_TRACE environment variable to the path of a
+  // trace replays it from `setup()`.
+  bool replayTrace(const char *path);
+  bool replayTrace(const uint8_t *data, size_t size);
+  bool replayingTrace() const {
+    return !trace_reader_.done() || trace_record_pending_;
+  }
+
  private:
 
   bool anythingHeld();
+  void replayTraceRecords();
+  void unmapTrace();
 
  private:
 
@@ -90,6 +108,13 @@ class VirtualKeyScanner
   KeyState keystates_prev_[matrix_rows * matrix_columns]; // NOLINT(runtime/arrays)
 
   bool mask_[matrix_rows * matrix_columns]; // NOLINT(runtime/arrays)
+
+  key_trace::Reader trace_reader_;
+  key_trace::Record trace_record_;
+  bool trace_record_pending_;
+  uint32_t trace_time_;
+  void *trace_mapping_;
+  size_t trace_mapping_size_;
 };
 
 class VirtualLEDDriver
@@ -36,7 +36,9 @@ class NoBootKeyboard {
   void setProtocol(uint8_t protocol) {}
   void setDefaultProtocol(uint8_t protocol) {}
 
-  void sendReport();
+  int sendReport() {
+    return 1;
+  }
 
   void press(uint8_t code) {}
   void release(uint8_t code) {}
@@ -65,7 +67,9 @@ class NoNKROKeyboard {
   NoNKROKeyboard() {}
   void begin() {}
 
-  void sendReport() {}
+  int sendReport() {
+    return 1;
+  }
 
   void press(uint8_t code) {}
   void release(uint8_t code) {}
@@ -153,9 +157,8 @@ class Keyboard {
     //
     // In most cases, this won't result in any difference from the previous report
     // (because the newly-toggled-on keycode won't be in the previous report), so
-    // no extra report will be sent (because we suppress duplicate reports in
-    // KeyboardioHID). If there is a difference in the modifiers byte, an extra
-    // report would be sent later, regardless (also in KeyboardioHID).
+    // no extra report will be sent (because `sendKeyboardReport()` skips reports
+    // identical to the last one sent).
     //
     // Furthermore, we need to send a report without the keycode for the
     // newly-toggled-on key, but with any masked modifiers from flags removed. For
@@ -165,34 +168,32 @@ class Keyboard {
     // processes the `B` keypress first, and we end up with `AB` instead of `Ab`
     // in the output.
 
-    if (boot_keyboard_.getProtocol() == HID_BOOT_PROTOCOL) {
-      if (last_keycode_toggled_on) {
-        boot_keyboard_.release(last_keycode_toggled_on);
-        boot_keyboard_.sendReport();
-        boot_keyboard_.press(last_keycode_toggled_on);
-        last_keycode_toggled_on = 0;
-      }
-      boot_keyboard_.sendReport();
-      return;
-    }
-
     if (last_keycode_toggled_on) {
-      // It would be good if KeyboardioHID's Keyboard object offered a way to
-      // compare the modifiers bytes of the current and previous key reports. That
-      // would allow us to only send these extra reports when either
-      // `last_keycode_toggled_on` was already held, or the modifiers byte
-      // changed. Likewise for BootKeyboard above.
-      nkro_keyboard_.release(last_keycode_toggled_on);
-      nkro_keyboard_.sendReport();
-      nkro_keyboard_.press(last_keycode_toggled_on);
+      // The extra report is only sent when it differs from the last one, that
+      // is, when the keycode was already held, or when the modifiers changed.
+      releaseRawKeycode(last_keycode_toggled_on);
+      sendKeyboardReport();
+      pressRawKeycode(last_keycode_toggled_on);
       last_keycode_toggled_on = 0;
     }
 
-    nkro_keyboard_.sendReport();
-    consumer_control_.sendReport();
+    sendKeyboardReport();
+
+    if (boot_keyboard_.getProtocol() == HID_BOOT_PROTOCOL)
+      return;
+
+    if (consumerControlReportChanged()) {
+      memcpy(sent_consumer_codes_, consumer_codes_, sizeof(consumer_codes_));
+      consumer_control_.sendReport();
+      report_stats_.sent++;
+    } else {
+      report_stats_.suppressed++;
+    }
   }
   void releaseAllKeys() __attribute__((noinline)) {
     resetModifierTracking();
+    memset(keycodes_, 0, sizeof(keycodes_));
+    memset(consumer_codes_, 0, sizeof(consumer_codes_));
     if (boot_keyboard_.getProtocol() == HID_BOOT_PROTOCOL) {
       boot_keyboard_.releaseAll();
     } else {
@@ -201,23 +202,64 @@ class Keyboard {
     }
   }
   void pressConsumerControl(Key mapped_key) {
-    consumer_control_.press(CONSUMER(mapped_key));
+    uint16_t code = CONSUMER(mapped_key);
+
+    for (uint8_t i = 0; i < consumer_report_size_; i++) {
+      if (consumer_codes_[i] == code)
+        break;
+      if (consumer_codes_[i] == 0) {
+        consumer_codes_[i] = code;
+        break;
+      }
+    }
+    consumer_control_.press(code);
   }
   void releaseConsumerControl(Key mapped_key) {
-    consumer_control_.release(CONSUMER(mapped_key));
+    uint16_t code = CONSUMER(mapped_key);
+
+    for (uint8_t i = 0; i < consumer_report_size_; i++) {
+      if (consumer_codes_[i] == code)
+        consumer_codes_[i] = 0;
+    }
+    consumer_control_.release(code);
   }
   void pressSystemControl(Key mapped_key) {
     uint8_t keycode = mapped_key.getKeyCode();
+    // The same keycode is still in the last report.
+    if (keycode == last_system_control_keycode_) {
+      report_stats_.suppressed++;
+      return;
+    }
     system_control_.press(keycode);
     last_system_control_keycode_ = keycode;
+    report_stats_.sent++;
   }
   void releaseSystemControl(Key mapped_key) {
     uint8_t keycode = mapped_key.getKeyCode();
     if (keycode == last_system_control_keycode_) {
       system_control_.release();
+      last_system_control_keycode_ = 0;
+      report_stats_.sent++;
     }
   }
 
+  // The number of reports sent to the host, the number of sends skipped
+  // because the report was the same as the last one sent, and the number of
+  // keyboard reports the HID library did not send, since startup or the last
+  // call to `resetReportStats()`. The consumer and system control reports do
+  // not tell whether they were sent, so they are always counted as sent.
+  struct ReportStats {
+    uint32_t sent;
+    uint32_t suppressed;
+    uint32_t failed;
+  };
+  const ReportStats &reportStats() const {
+    return report_stats_;
+  }
+  void resetReportStats() {
+    report_stats_ = ReportStats{};
+  }
+
   // pressKey takes a Key, as well as optional boolean 'toggledOn' which defaults
   // to 'true'
 
@@ -286,21 +328,11 @@ class Keyboard {
   // pressRawKey takes a Key object and calles KeyboardioHID's ".press" method
   // with its keycode. It does no processing of any flags or modifiers on the key
   void pressRawKey(Key pressed_key) {
-    if (boot_keyboard_.getProtocol() == HID_BOOT_PROTOCOL) {
-      boot_keyboard_.press(pressed_key.getKeyCode());
-      return;
-    }
-
-    nkro_keyboard_.press(pressed_key.getKeyCode());
+    pressRawKeycode(pressed_key.getKeyCode());
   }
 
   void releaseRawKey(Key released_key) {
-    if (boot_keyboard_.getProtocol() == HID_BOOT_PROTOCOL) {
-      boot_keyboard_.release(released_key.getKeyCode());
-      return;
-    }
-
-    nkro_keyboard_.release(released_key.getKeyCode());
+    releaseRawKeycode(released_key.getKeyCode());
   }
 
   void releaseKey(Key released_key) {
@@ -372,6 +404,7 @@ class Keyboard {
   }
   void setProtocol(uint8_t protocol) {
     boot_keyboard_.setProtocol(protocol);
+    keyboard_report_sent_ = false;
   }
   void setDefaultProtocol(uint8_t protocol) {
     boot_keyboard_.setDefaultProtocol(protocol);
@@ -380,10 +413,109 @@ class Keyboard {
  private:
   // To prevent premature release of a System Control key when rolling
   // over from one to another, we record the last System Control
-  // keycode that was pressed. It's initialized to zero, which should
-  // not be a valid System Control keycode.
+  // keycode that was pressed, until it is released. It's initialized to zero,
+  // which should not be a valid System Control keycode.
   uint8_t last_system_control_keycode_ = 0;
 
+  // The keycodes in the keyboard report being built, and in the last one sent,
+  // as bitmaps, along with the protocol it was sent with. The report is rebuilt
+  // every cycle, and comparing these lets the driver skip sending it when it
+  // has not changed. The latter is only updated when the HID library took the
+  // report, so it always mirrors the library's own last report. Likewise for
+  // the consumer control codes.
+  uint8_t keycodes_[32] = {};
+  uint8_t sent_keycodes_[32] = {};
+  uint8_t sent_protocol_ = 0;
+  bool keyboard_report_sent_ = false;
+
+  static constexpr uint8_t consumer_report_size_ = 4;
+  uint16_t consumer_codes_[consumer_report_size_] = {};
+  uint16_t sent_consumer_codes_[consumer_report_size_] = {};
+
+  ReportStats report_stats_ = {};
+
+  void pressRawKeycode(uint8_t keycode) {
+    bitSet(keycodes_[keycode >> 3], keycode & 7);
+    if (boot_keyboard_.getProtocol() == HID_BOOT_PROTOCOL) {
+      boot_keyboard_.press(keycode);
+      return;
+    }
+
+    nkro_keyboard_.press(keycode);
+  }
+
+  void releaseRawKeycode(uint8_t keycode) {
+    bitClear(keycodes_[keycode >> 3], keycode & 7);
+    if (boot_keyboard_.getProtocol() == HID_BOOT_PROTOCOL) {
+      boot_keyboard_.release(keycode);
+      return;
+    }
+
+    nkro_keyboard_.release(keycode);
+  }
+
+  // Sends the keyboard report, unless it is the same as the last one sent. A
+  // report that failed to send is not recorded, so it is tried again.
+  void sendKeyboardReport() {
+    uint8_t protocol = boot_keyboard_.getProtocol();
+    bool in_sync = keyboard_report_sent_ && protocol == sent_protocol_;
+
+    if (in_sync && memcmp(keycodes_, sent_keycodes_, sizeof(keycodes_)) == 0) {
+      report_stats_.suppressed++;
+      return;
+    }
+
+    int result;
+    if (protocol == HID_BOOT_PROTOCOL) {
+      result = boot_keyboard_.sendReport();
+    } else {
+      result = nkro_keyboard_.sendReport();
+    }
+
+    if (result > 0) {
+      report_stats_.sent++;
+    } else if (in_sync) {
+      // The HID library only refuses a report that differs from its last one
+      // when sending it failed. The shadow still matches what the host has, so
+      // the report is tried again next cycle.
+      report_stats_.failed++;
+      return;
+    } else {
+      // At startup, and after the protocol changed, there is no shadow of the
+      // library's last report yet, and it also refuses to send one that is the
+      // same as that. Take the report as already sent, rather than retrying it
+      // every cycle.
+      report_stats_.suppressed++;
+    }
+    keyboard_report_sent_ = true;
+    memcpy(sent_keycodes_, keycodes_, sizeof(keycodes_));
+    sent_protocol_ = protocol;
+  }
+
+  // Consumer control codes are kept in the order they were pressed, so the
+  // reports are compared as sets.
+  bool consumerControlReportChanged() const {
+    for (uint8_t i = 0; i < consumer_report_size_; i++) {
+      uint16_t code = consumer_codes_[i];
+      uint16_t sent_code = sent_consumer_codes_[i];
+      if (code == sent_code)
+        continue;
+      if (!hasConsumerCode(sent_consumer_codes_, code) ||
+          !hasConsumerCode(consumer_codes_, sent_code))
+        return true;
+    }
+    return false;
+  }
+  static bool hasConsumerCode(const uint16_t *codes, uint16_t code) {
+    if (code == 0)
+      return true;
+    for (uint8_t i = 0; i < consumer_report_size_; i++) {
+      if (codes[i] == code)
+        return true;
+    }
+    return false;
+  }
+
   // modifier_flag_mask is a bitmask of modifiers that we found attached to
   // keys that were newly pressed down during the most recent cycle with any new
   // keypresses.
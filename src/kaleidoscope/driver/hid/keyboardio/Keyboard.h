@@ -55,8 +55,8 @@ class BootKeyboardWrapper {
     setProtocol(protocol);
   }
 
-  void sendReport() {
-    BootKeyboard.sendReport();
+  int sendReport() {
+    return BootKeyboard.sendReport();
   }
 
   void press(uint8_t code) {
@@ -94,8 +94,8 @@ class NKROKeyboardWrapper {
     Keyboard.begin();
   }
 
-  void sendReport() {
-    Keyboard.sendReport();
+  int sendReport() {
+    return Keyboard.sendReport();
   }
 
   void press(uint8_t code) {
@@ -95,8 +95,14 @@ class ATmega: public kaleidoscope::driver::keyscanner::Base<_KeyScannerProps> {
     TIMSK1 = _BV(TOIE1);
   }
 
+  // Reads the matrix only when the scan timer has fired since the last read,
+  // so that debouncing runs at a steady pace.
   __attribute__((optimize(3)))
   void readMatrix(void) {
+    if (!do_scan_)
+      return;
+    do_scan_ = false;
+
     typename _KeyScannerProps::RowState any_debounced_changes = 0;
 
     for (uint8_t current_row = 0; current_row < _KeyScannerProps::matrix_rows; current_row++) {
@@ -115,20 +121,25 @@ class ATmega: public kaleidoscope::driver::keyscanner::Base<_KeyScannerProps> {
     }
   }
   void scanMatrix() {
-    if (do_scan_) {
-      do_scan_ = false;
-      readMatrix();
-    }
+    readMatrix();
     actOnMatrixScan();
   }
 
   void __attribute__((optimize(3))) actOnMatrixScan() {
     for (byte row = 0; row < _KeyScannerProps::matrix_rows; row++) {
-      for (byte col = 0; col < _KeyScannerProps::matrix_columns; col++) {
-        uint8_t keyState = (bitRead(matrix_state_[row].previous, col) << 0) | (bitRead(matrix_state_[row].current, col) << 1);
+      typename _KeyScannerProps::RowState current = matrix_state_[row].current;
+      typename _KeyScannerProps::RowState previous = matrix_state_[row].previous;
+
+      // Keys that are up and were up on the previous scan have nothing to
+      // report, so stop as soon as the remaining columns are all idle. A row
+      // with no key down is skipped without looking at any column.
+      for (byte col = 0; (current | previous) != 0; col++) {
+        uint8_t keyState = ((previous & 1) << 0) | ((current & 1) << 1);
         if (keyState) {
           ThisType::handleKeyswitchEvent(Key_NoKey, typename _KeyScannerProps::KeyAddr(row, col), keyState);
         }
+        current >>= 1;
+        previous >>= 1;
       }
       matrix_state_[row].previous = matrix_state_[row].current;
     }
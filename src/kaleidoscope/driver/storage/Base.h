@@ -52,6 +52,27 @@ class Base {
 
   void setup() {}
   void commit() {}
+
+  // Drivers that defer commits do the actual writing from `sync()`, which is
+  // called once every cycle, or from `flush()`, which writes any pending
+  // changes right away. Drivers that keep a change log next to the main copy
+  // of the data merge the two in `compact()`.
+  void sync() {}
+  void flush() {}
+  void compact() {}
+
+  // Number of bytes changed, commits requested, and times the underlying
+  // medium had to be erased and rewritten. Drivers that do not keep track
+  // return zero.
+  uint32_t writeCount() {
+    return 0;
+  }
+  uint32_t commitCount() {
+    return 0;
+  }
+  uint32_t eraseCount() {
+    return 0;
+  }
 };
 
 }
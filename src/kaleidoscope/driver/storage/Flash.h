@@ -28,9 +28,23 @@
 #ifdef __SAMD21G18A__
 
 #include "kaleidoscope/driver/storage/Base.h"
+#include "kaleidoscope/driver/storage/FlashLog.h"
 #include <FlashStorage.h>
 #include <FlashAsEEPROM.h>
 
+// Commits are deferred until there were no commit requests for this many
+// milliseconds, so that a burst of small settings changes ends up rewriting the
+// flash only once.
+#ifndef KALEIDOSCOPE_FLASH_COMMIT_DELAY
+#define KALEIDOSCOPE_FLASH_COMMIT_DELAY 1000
+#endif
+
+// Size of the change log kept next to the emulated EEPROM, in bytes. It must be
+// a multiple of the flash row size (256 bytes).
+#ifndef KALEIDOSCOPE_FLASH_LOG_SIZE
+#define KALEIDOSCOPE_FLASH_LOG_SIZE 8192
+#endif
+
 // We need to undefine Flash, because `FlashStorage` defines it as a macro, yet,
 // we want to use it as a class name.
 #undef Flash
@@ -43,36 +57,157 @@ struct FlashProps : kaleidoscope::driver::storage::BaseProps {
   static constexpr uint16_t length = EEPROM_EMULATION_SIZE;
 };
 
+/*
+ * The emulated EEPROM lives in RAM, and FlashAsEEPROM writes it to flash as a
+ * whole, erasing every row it occupies. To avoid doing that for every small
+ * settings change, commits only append the changed blocks to a log in a
+ * separate flash area (see FlashLog.h). On startup, the records are replayed
+ * on top of the last full image, and when the log fills up, the image is
+ * written in full and the log is erased.
+ */
 template <typename _StorageProps>
 class Flash: public kaleidoscope::driver::storage::Base<_StorageProps> {
  public:
   template<typename T>
   T& get(uint16_t offset, T& t) {
+    begin();
     return EEPROM.get(offset, t);
   }
 
   template<typename T>
   const T& put(uint16_t offset, T& t) {
-    EEPROM.put(offset, t);
+    const uint8_t *p = (const uint8_t *)&t;
+    for (uint16_t i = 0; i < sizeof(T); i++)
+      update(offset + i, p[i]);
+    return t;
   }
 
   uint8_t read(int idx) {
+    begin();
     return EEPROM.read(idx);
   }
 
   void write(int idx, uint8_t val) {
-    EEPROM.write(idx, val);
+    update(idx, val);
   }
 
   void update(int idx, uint8_t val) {
+    begin();
+    if (EEPROM.read(idx) == val)
+      return;
+
     EEPROM.update(idx, val);
+    dirty_blocks_[idx / block_size / 8] |= 1 << ((idx / block_size) % 8);
+    dirty_ = true;
+    write_count_++;
+  }
+
+  void setup() {
+    begin();
   }
 
   void commit() {
+    commit_count_++;
+    if (!dirty_)
+      return;
+
+    commit_pending_ = true;
+    commit_requested_at_ = millis();
+  }
+
+  void sync() {
+    if (commit_pending_ &&
+        millis() - commit_requested_at_ >= KALEIDOSCOPE_FLASH_COMMIT_DELAY)
+      flush();
+  }
+
+  void flush() {
+    commit_pending_ = false;
+    if (!dirty_)
+      return;
+
+    uint16_t blocks = 0;
+    for (uint16_t i = 0; i < sizeof(dirty_blocks_); i++)
+      blocks += __builtin_popcount(dirty_blocks_[i]);
+
+    // If the changes do not fit in the log - or they are so large that
+    // logging them would just fill it up quickly - write the whole image.
+    if (!log_.fits(blocks) ||
+        blocks * sizeof(typename Log::Record) > KALEIDOSCOPE_FLASH_LOG_SIZE / 2) {
+      compact();
+      return;
+    }
+
+    for (uint16_t block = 0; block < block_count; block++) {
+      if (dirty_blocks_[block / 8] & (1 << (block % 8)))
+        log_.append(block);
+    }
+
+    memset(dirty_blocks_, 0, sizeof(dirty_blocks_));
+    dirty_ = false;
+  }
+
+  // Writes the whole image, including pending changes, and empties the log.
+  void compact() {
+    commit_pending_ = false;
+    if (!dirty_ && log_.empty())
+      return;
+
     EEPROM.commit();
+    log_.reset();
+    erase_count_++;
+
+    memset(dirty_blocks_, 0, sizeof(dirty_blocks_));
+    dirty_ = false;
+  }
+
+  uint32_t writeCount() {
+    return write_count_;
+  }
+  uint32_t commitCount() {
+    return commit_count_;
+  }
+  uint32_t eraseCount() {
+    return erase_count_;
+  }
+
+ private:
+  typedef FlashLog<FlashClass, EEPROMClass,
+                   EEPROM_EMULATION_SIZE, KALEIDOSCOPE_FLASH_LOG_SIZE> Log;
+
+  static constexpr uint16_t block_size = Log::block_size;
+  static constexpr uint16_t block_count = EEPROM_EMULATION_SIZE / block_size;
+
+  // As far as the compiler knows, `log_area_` is all zeroes, so it is only
+  // ever read through FlashClass, like FlashStorage does.
+  static const uint8_t log_area_[KALEIDOSCOPE_FLASH_LOG_SIZE];
+
+  FlashClass flash_;
+  Log log_{flash_, EEPROM, log_area_};
+  bool initialized_ = false;
+  uint8_t dirty_blocks_[(block_count + 7) / 8] = {};
+
+  bool dirty_ = false;
+  bool commit_pending_ = false;
+  uint32_t commit_requested_at_ = 0;
+  uint32_t write_count_ = 0;
+  uint32_t commit_count_ = 0;
+  uint32_t erase_count_ = 0;
+
+  void begin() {
+    if (initialized_)
+      return;
+    initialized_ = true;
+
+    if (log_.replay())
+      erase_count_++;
   }
 };
 
+template <typename _StorageProps>
+__attribute__((__aligned__(256)))
+const uint8_t Flash<_StorageProps>::log_area_[KALEIDOSCOPE_FLASH_LOG_SIZE] = {};
+
 }
 }
 }
@@ -0,0 +1,155 @@
+/* -*- mode: c++ -*-
+ * kaleidoscope::driver::storage::FlashLog -- Change log for emulated EEPROM
+ * Copyright (C) 2020  Keyboard.io, Inc
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kaleidoscope/util/crc16.h"
+
+namespace kaleidoscope {
+namespace driver {
+namespace storage {
+
+/*
+ * A log of changes to an emulated EEPROM image, kept in an area of flash (see
+ * the Flash storage driver). Each 32-byte record holds one 16-byte block of the
+ * image, and a checksum.
+ *
+ * `_Flash` reads, writes and erases flash, like FlashStorage's `FlashClass`:
+ * writing can only clear bits, erasing sets them all. `_Image` is the emulated
+ * EEPROM, with the `read()`, `update()` and `commit()` methods of
+ * FlashAsEEPROM, the latter writing the whole image to flash.
+ */
+template <typename _Flash, typename _Image, uint16_t _image_size, uint16_t _log_size>
+class FlashLog {
+ public:
+  static constexpr uint16_t block_size = 16;
+
+  // Flash is written a 64-byte page at a time, and FlashClass::write() does
+  // not split writes at page boundaries. Records are therefore padded to 32
+  // bytes, and the magic number takes up a whole record slot, so that no
+  // record ever straddles two pages.
+  struct Record {
+    uint16_t offset;
+    uint16_t crc;
+    uint8_t data[block_size];
+    uint8_t padding[12];
+  };
+  static_assert(sizeof(Record) == 32, "Flash log records must be 32 bytes long");
+
+  static constexpr uint16_t log_start = sizeof(Record);
+
+  FlashLog(_Flash &flash, _Image &image, const uint8_t *log)
+    : flash_(flash), image_(image), log_(log) {}
+
+  // Replays the log on top of the image, up to the first record that is either
+  // unwritten, or was torn by a reset while writing it. Returns true if the log
+  // had to be compacted.
+  //
+  // A torn record is not blank flash, and a new record can't be written over
+  // it, so the image - with every record before it replayed - is written in
+  // full then, and a new log is started.
+  bool replay() {
+    uint32_t magic;
+    flash_.read(log_, &magic, sizeof(magic));
+    if (magic != log_magic) {
+      // Freshly flashed firmware: the log area holds no records yet.
+      reset();
+      return false;
+    }
+
+    pos_ = log_start;
+    while (fits(1)) {
+      Record record;
+      flash_.read(log_ + pos_, &record, sizeof(record));
+      if (record.offset >= _image_size || record.crc != recordCRC(record)) {
+        if (isBlank(record))
+          return false;
+
+        image_.commit();
+        reset();
+        return true;
+      }
+
+      for (uint8_t i = 0; i < block_size; i++)
+        image_.update(record.offset + i, record.data[i]);
+      pos_ += sizeof(record);
+    }
+    return false;
+  }
+
+  // When compacting, the full image has to be written before the log is
+  // erased: if we are interrupted in between, replaying the old log on top of
+  // the new image is harmless, as the image already contains everything in it.
+  void reset() {
+    uint32_t magic = log_magic;
+    flash_.erase(log_, _log_size);
+    flash_.write(log_, &magic, sizeof(magic));
+    pos_ = log_start;
+  }
+
+  void append(uint16_t block) {
+    Record record;
+    memset(record.padding, 0xff, sizeof(record.padding));
+    record.offset = block * block_size;
+    for (uint8_t i = 0; i < block_size; i++)
+      record.data[i] = image_.read(record.offset + i);
+    record.crc = recordCRC(record);
+
+    flash_.write(log_ + pos_, &record, sizeof(record));
+    pos_ += sizeof(record);
+  }
+
+  // Whether `records` more records fit in the log.
+  bool fits(uint16_t records) const {
+    return pos_ + records * sizeof(Record) <= _log_size;
+  }
+  bool empty() const {
+    return pos_ == log_start;
+  }
+
+ private:
+  static constexpr uint32_t log_magic = 0x474f4c4b; // "KLOG"
+
+  _Flash &flash_;
+  _Image &image_;
+  const uint8_t *log_;
+  uint16_t pos_ = 0;
+
+  static uint16_t recordCRC(const Record &record) {
+    uint16_t crc = _crc_ccitt_update(0xffff, record.offset & 0xff);
+    crc = _crc_ccitt_update(crc, record.offset >> 8);
+    for (uint8_t i = 0; i < block_size; i++)
+      crc = _crc_ccitt_update(crc, record.data[i]);
+    return crc;
+  }
+
+  static bool isBlank(const Record &record) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&record);
+    for (uint8_t i = 0; i < sizeof(record); i++) {
+      if (p[i] != 0xff)
+        return false;
+    }
+    return true;
+  }
+};
+
+}
+}
+}
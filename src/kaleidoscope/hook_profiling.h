@@ -0,0 +1,88 @@
+/* Kaleidoscope - Firmware for computer input devices
+ * Copyright (C) 2013-2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "kaleidoscope/macro_helpers.h"
+#include "kaleidoscope/event_handlers.h"
+
+// When the sketch is built with KALEIDOSCOPE_HOOK_PROFILING set to 1,
+// KALEIDOSCOPE_INIT_PLUGINS(...) generates event dispatchers that time every
+// call of a plugin's event handler, and keep a count, the total and the
+// maximum time (in microseconds) for each plugin and hook. Without it, the
+// dispatchers are exactly the same as before, and the functions below are weak
+// stubs that report nothing.
+
+#ifndef KALEIDOSCOPE_HOOK_PROFILING
+#define KALEIDOSCOPE_HOOK_PROFILING 0
+#endif
+
+namespace kaleidoscope {
+namespace hook_profiling {
+
+#define _HOOK_PROFILING_INDEX(                                                 \
+    HOOK_NAME, HOOK_VERSION, DEPRECATION_TAG,                                  \
+    SHOULD_ABORT_ON_CONSUMED_EVENT,                                            \
+    TMPL_PARAM_TYPE_LIST, TMPL_PARAM_LIST, TMPL_DUMMY_ARGS_LIST,               \
+    SIGNATURE, ARGS_LIST)                                                      \
+  _HOOK_PROFILING_INDEX_NAME(HOOK_NAME, HOOK_VERSION),
+
+#define _HOOK_PROFILING_INDEX_NAME(HOOK_NAME, HOOK_VERSION)                    \
+  HOOK_NAME##_v##HOOK_VERSION
+
+// One index per event handler (and version), in the order of
+// _FOR_EACH_EVENT_HANDLER.
+enum HookIndex : uint8_t {
+  _FOR_EACH_EVENT_HANDLER(_HOOK_PROFILING_INDEX)
+  hook_count
+};
+
+#undef _HOOK_PROFILING_INDEX
+#undef _HOOK_PROFILING_INDEX_NAME
+
+struct Entry {
+  uint32_t count;
+  uint32_t total;
+  uint16_t max;
+};
+
+// The entry of a plugin (by its position in KALEIDOSCOPE_INIT_PLUGINS(...))
+// and hook, or nullptr when profiling is not enabled.
+Entry *entry(uint8_t plugin_index, uint8_t hook_index);
+void reset();
+
+// The names of the plugins, and of the hooks, each terminated by a newline,
+// in PROGMEM.
+const char *pluginNames();
+const char *hookNames();
+
+// The clock the handlers are timed with, in microseconds: micros() on the
+// device, and the host's steady clock in virtual builds.
+uint32_t clock();
+
+inline void record(uint8_t plugin_index, uint8_t hook_index, uint32_t time) {
+  Entry *e = entry(plugin_index, hook_index);
+
+  e->count++;
+  e->total += time;
+  if (time > e->max)
+    e->max = time > UINT16_MAX ? UINT16_MAX : time;
+}
+
+}
+}
@@ -18,6 +18,11 @@
 #include "kaleidoscope/event_handlers.h"
 #include "kaleidoscope/macro_helpers.h"
 #include "kaleidoscope/hooks.h"
+#include "kaleidoscope/hook_profiling.h"
+
+#ifdef KALEIDOSCOPE_VIRTUAL_BUILD
+#include <chrono>
+#endif
 
 namespace kaleidoscope {
 
@@ -47,6 +52,62 @@ _FOR_EACH_EVENT_HANDLER(INSTANTIATE_WEAK_HOOK_FUNCTION)
 
 #undef INSTANTIATE_WEAK_HOOK_FUNCTION
 
+__attribute__((weak))
+EventHandlerResult Hooks::onFocusEventFor(uint8_t plugin_index,
+    const char *command) {
+  return EventHandlerResult::OK;
+}
+
+__attribute__((weak))
+uint8_t Hooks::pluginCount() {
+  return 0;
+}
+
+namespace hook_profiling {
+
+// Defined by KALEIDOSCOPE_INIT_PLUGINS(...) in sketches built with
+// KALEIDOSCOPE_HOOK_PROFILING.
+
+__attribute__((weak))
+Entry *entry(uint8_t plugin_index, uint8_t hook_index) {
+  return nullptr;
+}
+
+__attribute__((weak))
+void reset() {
+}
+
+__attribute__((weak))
+const char *pluginNames() {
+  return PSTR("");
+}
+
+#define _HOOK_PROFILING_NAME(                                                  \
+    HOOK_NAME, HOOK_VERSION, DEPRECATION_TAG,                                  \
+    SHOULD_ABORT_ON_CONSUMED_EVENT,                                            \
+    TMPL_PARAM_TYPE_LIST, TMPL_PARAM_LIST, TMPL_DUMMY_ARGS_LIST,               \
+    SIGNATURE, ARGS_LIST)                                                      \
+  #HOOK_NAME "\n"
+
+const char *hookNames() {
+  return PSTR(_FOR_EACH_EVENT_HANDLER(_HOOK_PROFILING_NAME));
+}
+
+#undef _HOOK_PROFILING_NAME
+
+uint32_t clock() {
+#ifdef KALEIDOSCOPE_VIRTUAL_BUILD
+  // The simulated micros() advances by a fixed step per call, which would make
+  // every handler look equally expensive.
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+  return micros();
+#endif
+}
+
+}
+
 namespace sketch_exploration {
 class Sketch;
 }
@@ -35,6 +35,7 @@ namespace kaleidoscope {
 namespace plugin {
 // Forward declaration to enable friend declarations.
 class LEDControl;
+class FocusSerial;
 }
 
 // Forward declaration to enable friend declarations.
@@ -63,6 +64,7 @@ class Hooks {
   friend class Runtime_;
   friend class ::kaleidoscope::Layer_;
   friend class ::kaleidoscope::plugin::LEDControl;
+  friend class ::kaleidoscope::plugin::FocusSerial;
   friend void ::kaleidoscope::sketch_exploration::pluginsExploreSketch();
 
   // ::handleKeyswitchEvent(...) calls Hooks::onKeyswitchEvent.
@@ -86,6 +88,13 @@ class Hooks {
   _FOR_EACH_EVENT_HANDLER(DEFINE_WEAK_HOOK_FUNCTION)
 
 #undef DEFINE_WEAK_HOOK_FUNCTION
+
+  // Calls the onFocusEvent handler of a single plugin, identified by its
+  // position in KALEIDOSCOPE_INIT_PLUGINS(...). This lets FocusSerial route
+  // commands straight to the plugin that handles them.
+  static EventHandlerResult onFocusEventFor(uint8_t plugin_index,
+                                            const char *command);
+  static uint8_t pluginCount();
 };
 
 }
@@ -64,5 +64,12 @@
  * previous state of the key, so we can determine what the event is. The
  * currentState may be flagged INJECTED, which signals that the event was
  * injected, and is not a direct result of a keypress, coming from the scanner.
+ *
+ * Held keys are reported every cycle, because the HID report is rebuilt from
+ * scratch on each cycle. When the sketch is built with
+ * KALEIDOSCOPE_KEYSWITCH_TOGGLE_EVENTS_ONLY set to 1, physical keys that are
+ * merely held still go through the keymap lookup and end up in the report, but
+ * only plugins that declare `HeldKeys` (see key_routing.h) have their
+ * onKeyswitchEvent() handler called for them.
  */
 void handleKeyswitchEvent(Key mappedKey, kaleidoscope::Device::Props::KeyScannerProps::KeyAddr key_addr, uint8_t keyState);
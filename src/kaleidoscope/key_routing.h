@@ -0,0 +1,225 @@
+/* Kaleidoscope - Firmware for computer input devices
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "kaleidoscope/key_defs.h"
+
+// Many plugins start their `onKeyswitchEvent()` handler by returning
+// `EventHandlerResult::OK` for any key that is not one of theirs. Such a
+// plugin can declare the keys it handles with a `RoutedKeys` typedef, built
+// from the templates below:
+//
+//   typedef kaleidoscope::key_routing::KeyRange<ranges::MACRO_FIRST,
+//                                               ranges::MACRO_LAST> RoutedKeys;
+//
+// The event dispatcher then checks the key inline, and does not call the
+// plugin's `onKeyswitchEvent()` for other keys.
+// The check is made when the plugin's turn comes, so it sees the key as left
+// by the plugins before it.
+//
+// Only declare this for plugins that do nothing at all with other keys: one
+// that needs to notice other keys being pressed (to interrupt a tap dance, or
+// to end a leader sequence, for example) must keep seeing every event.
+//
+// When the sketch is built with KALEIDOSCOPE_KEYMAP_PRUNING set to 1, the key
+// event handlers of such a plugin are dropped at compile time altogether if
+// none of its keys can ever show up: none are in the keymap, and no other
+// plugin declares `ProducedKeys` that may overlap with its `RoutedKeys`.
+// Plugins that inject keys from their own configuration (or, like
+// EEPROMKeymap, replace the keymap) must therefore declare what they produce:
+//
+//   typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+//
+// Pruning is off by default, because it also relies on plugins outside of this
+// repository, and on code in the sketch itself, to not inject keys that are
+// neither in the keymap nor declared.
+//
+// When the sketch is built with KALEIDOSCOPE_KEYSWITCH_TOGGLE_EVENTS_ONLY set to
+// 1, physical keys that are merely held (neither pressed nor released in the
+// current cycle) still end up in the report, but a plugin is only called for
+// the held keys it asks for with a `HeldKeys` typedef:
+//
+//   typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+//
+// Plugins that only act on presses and releases need not declare it, and
+// neither do plugins that only swallow their own keys while they are held: the
+// core ignores those anyway.
+
+#ifndef KALEIDOSCOPE_KEYMAP_PRUNING
+#define KALEIDOSCOPE_KEYMAP_PRUNING 0
+#endif
+
+#ifndef KALEIDOSCOPE_KEYSWITCH_TOGGLE_EVENTS_ONLY
+#define KALEIDOSCOPE_KEYSWITCH_TOGGLE_EVENTS_ONLY 0
+#endif
+
+namespace kaleidoscope {
+namespace key_routing {
+
+// Besides `matches()`, every route has `first` and `last`: the lowest and
+// highest raw key value it can match. These are only used to tell whether two
+// routes may overlap, so they are allowed to be loose.
+
+// Every key. This is what plugins without a `RoutedKeys` typedef get.
+struct AnyKey {
+  static constexpr uint16_t first = 0;
+  static constexpr uint16_t last = 0xffff;
+
+  static constexpr bool matches(Key key) {
+    return true;
+  }
+};
+
+// No key at all. This is what plugins without a `ProducedKeys` typedef get.
+struct NoKey {
+  static constexpr uint16_t first = 1;
+  static constexpr uint16_t last = 0;
+
+  static constexpr bool matches(Key key) {
+    return false;
+  }
+};
+
+// Keys whose raw value is between `_first` and `_last`, inclusive.
+template <uint16_t _first, uint16_t _last>
+struct KeyRange {
+  static constexpr uint16_t first = _first;
+  static constexpr uint16_t last = _last;
+
+  static constexpr bool matches(Key key) {
+    return key.getRaw() >= _first && key.getRaw() <= _last;
+  }
+};
+
+// Keys with exactly the given flags, such as `SYNTHETIC | IS_MOUSE_KEY`.
+template <uint8_t _flags>
+struct KeyFlags {
+  static constexpr uint16_t first = _flags << 8;
+  static constexpr uint16_t last = (_flags << 8) | 0xff;
+
+  static constexpr bool matches(Key key) {
+    return key.getFlags() == _flags;
+  }
+};
+
+// Keys that match any of the given routes.
+template <typename... _Routes>
+struct AnyOf;
+
+template <typename _Route>
+struct AnyOf<_Route> {
+  static constexpr uint16_t first = _Route::first;
+  static constexpr uint16_t last = _Route::last;
+
+  static constexpr bool matches(Key key) {
+    return _Route::matches(key);
+  }
+};
+
+template <typename _Route, typename... _Routes>
+struct AnyOf<_Route, _Routes...> {
+  static constexpr uint16_t first =
+    _Route::first < AnyOf<_Routes...>::first ? _Route::first : AnyOf<_Routes...>::first;
+  static constexpr uint16_t last =
+    _Route::last > AnyOf<_Routes...>::last ? _Route::last : AnyOf<_Routes...>::last;
+
+  static constexpr bool matches(Key key) {
+    return _Route::matches(key) || AnyOf<_Routes...>::matches(key);
+  }
+};
+
+// Whether some key may match both `_A` and `_B`. The members of an `AnyOf`
+// are compared one by one; other routes by their `first` and `last` keys.
+template <typename _A, typename _B>
+struct Overlap {
+  static constexpr bool value =
+    _A::first <= _A::last && _B::first <= _B::last &&
+    _A::first <= _B::last && _B::first <= _A::last;
+};
+
+template <typename _A, typename... _Bs>
+struct Overlap<_A, AnyOf<_Bs...>> {
+  static constexpr bool value = Overlap<AnyOf<_Bs...>, _A>::value;
+};
+
+template <typename _B>
+struct Overlap<AnyOf<>, _B> {
+  static constexpr bool value = false;
+};
+
+template <typename _Route, typename... _Routes, typename _B>
+struct Overlap<AnyOf<_Route, _Routes...>, _B> {
+  static constexpr bool value =
+    Overlap<_Route, _B>::value || Overlap<AnyOf<_Routes...>, _B>::value;
+};
+
+template <typename... _Bs>
+struct Overlap<AnyOf<>, AnyOf<_Bs...>> {
+  static constexpr bool value = false;
+};
+
+template <typename _Route, typename... _Routes, typename... _Bs>
+struct Overlap<AnyOf<_Route, _Routes...>, AnyOf<_Bs...>> {
+  static constexpr bool value =
+    Overlap<_Route, AnyOf<_Bs...>>::value || Overlap<AnyOf<_Routes...>, AnyOf<_Bs...>>::value;
+};
+
+// The routes declared by `_Plugin`, or `AnyKey` if it does not declare any.
+template <typename _Plugin, typename = void>
+struct RoutedKeysOf {
+  typedef AnyKey type;
+};
+
+template <typename...>
+struct Void {
+  typedef void type;
+};
+
+template <typename _Plugin>
+struct RoutedKeysOf<_Plugin, typename Void<typename _Plugin::RoutedKeys>::type> {
+  typedef typename _Plugin::RoutedKeys type;
+};
+
+// The keys `_Plugin` may send through the key event handlers, besides the ones
+// it was handed: keys it reads from its configuration, or from EEPROM, and
+// injects with `handleKeyswitchEvent()`, or puts in place of the mapped key.
+// `NoKey` if it does not declare any.
+template <typename _Plugin, typename = void>
+struct ProducedKeysOf {
+  typedef NoKey type;
+};
+
+template <typename _Plugin>
+struct ProducedKeysOf<_Plugin, typename Void<typename _Plugin::ProducedKeys>::type> {
+  typedef typename _Plugin::ProducedKeys type;
+};
+
+// The held keys `_Plugin` wants to be called for, when the sketch is built
+// with KALEIDOSCOPE_KEYSWITCH_TOGGLE_EVENTS_ONLY. `NoKey` if it does not
+// declare any.
+template <typename _Plugin, typename = void>
+struct HeldKeysOf {
+  typedef NoKey type;
+};
+
+template <typename _Plugin>
+struct HeldKeysOf<_Plugin, typename Void<typename _Plugin::HeldKeys>::type> {
+  typedef typename _Plugin::HeldKeys type;
+};
+
+} // namespace key_routing
+} // namespace kaleidoscope
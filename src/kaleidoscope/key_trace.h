@@ -0,0 +1,109 @@
+/* Kaleidoscope - Firmware for computer input devices
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The binary format of key event traces, as recorded by the KeyTrace plugin
+// and replayed by the virtual key scanner.
+//
+// A trace starts with a four byte header: the letters `K` and `T`, the format
+// version, and the number of keys on the device that recorded it. It is
+// followed by three byte records, one per keyswitch toggle:
+//
+//  - bytes 0 and 1: the time since the previous record, in milliseconds, as a
+//    little endian 15 bit number. The top bit is set when the key toggled on.
+//  - byte 2: the key's address, as in `KeyAddr::toInt()`.
+//
+// Pauses longer than `max_delta` are recorded as extra records with
+// `idle_key` as their address, which only advance time.
+
+namespace kaleidoscope {
+namespace key_trace {
+
+constexpr uint8_t version = 1;
+constexpr uint8_t header_size = 4;
+constexpr uint8_t record_size = 3;
+constexpr uint16_t max_delta = 0x7fff;
+constexpr uint16_t pressed_bit = 0x8000;
+constexpr uint8_t idle_key = 0xff;
+
+inline void writeHeader(uint8_t *buffer, uint8_t key_count) {
+  buffer[0] = 'K';
+  buffer[1] = 'T';
+  buffer[2] = version;
+  buffer[3] = key_count;
+}
+
+inline bool isValidHeader(const uint8_t *buffer, size_t size) {
+  return size >= header_size &&
+         buffer[0] == 'K' && buffer[1] == 'T' && buffer[2] == version;
+}
+
+// The number of keys of the device that recorded the trace. Key addresses are
+// only meaningful on a device with the same number of keys.
+inline uint8_t keyCount(const uint8_t *buffer) {
+  return buffer[3];
+}
+
+inline void writeRecord(uint8_t *buffer, uint16_t delta, uint8_t key,
+                        bool pressed) {
+  uint16_t time = delta | (pressed ? pressed_bit : 0);
+
+  buffer[0] = time & 0xff;
+  buffer[1] = time >> 8;
+  buffer[2] = key;
+}
+
+struct Record {
+  uint16_t delta;
+  uint8_t key;
+  bool pressed;
+};
+
+// Walks the records of a trace in place, without copying it.
+class Reader {
+ public:
+  Reader(const uint8_t *data, size_t size)
+    : next_(data), end_(data + size) {
+    next_ = isValidHeader(data, size) ? data + header_size : end_;
+  }
+
+  bool done() const {
+    return end_ - next_ < record_size;
+  }
+
+  Record read() {
+    uint16_t time = next_[0] | (next_[1] << 8);
+    Record record = {
+      static_cast<uint16_t>(time & max_delta),
+      next_[2],
+      (time & pressed_bit) != 0
+    };
+
+    next_ += record_size;
+    return record;
+  }
+
+ private:
+  const uint8_t *next_;
+  const uint8_t *end_;
+};
+
+}
+}
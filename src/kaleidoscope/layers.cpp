@@ -44,7 +44,24 @@ int8_t Layer_::active_layers_[31];
 
 Key Layer_::live_composite_keymap_[Runtime.device().numKeys()];
 uint8_t Layer_::active_layer_keymap_[Runtime.device().numKeys()];
+uint8_t Layer_::opaque_keys_[KALEIDOSCOPE_MAX_CACHED_LAYERS][Layer_::opaque_keys_bytes_];
+Layer_::GetKeyFunction Layer_::cached_get_key_;
+uint8_t Layer_::cached_layer_count_;
 Layer_::GetKeyFunction Layer_::getKey = &Layer_::getKeyFromPROGMEM;
+KeyIndex *Layer_::key_indexes_;
+
+KeyAddr KeyIndex::find(uint8_t from) const {
+  for (uint16_t i = from; i < KeyAddr::upper_limit; i++) {
+    // Skip over whole bytes without matches.
+    if (i % 8 == 0 && keys_[i / 8] == 0) {
+      i += 7;
+      continue;
+    }
+    if (bitRead(keys_[i / 8], i % 8))
+      return KeyAddr(uint8_t(i));
+  }
+  return KeyAddr(KeyAddr::upper_limit);
+}
 
 void Layer_::setup() {
   // Explicitly set layer 0's state to 1
@@ -129,25 +146,97 @@ void Layer_::updateLiveCompositeKeymap(KeyAddr key_addr) {
   live_composite_keymap_[key_addr.toInt()] = (*getKey)(layer, key_addr);
 }
 
+void Layer_::updateTransparencyCache(void) {
+  memset(opaque_keys_, 0, sizeof(opaque_keys_));
+
+  uint8_t layers = layer_count;
+  if (layers > KALEIDOSCOPE_MAX_CACHED_LAYERS)
+    layers = KALEIDOSCOPE_MAX_CACHED_LAYERS;
+
+  for (uint8_t layer = 0; layer < layers; layer++) {
+    for (auto key_addr : KeyAddr::all()) {
+      if ((*getKey)(layer, key_addr) != Key_Transparent) {
+        uint8_t i = key_addr.toInt();
+        bitSet(opaque_keys_[layer][i / 8], i % 8);
+      }
+    }
+  }
+
+  cached_get_key_ = getKey;
+  cached_layer_count_ = layer_count;
+}
+
+bool Layer_::isTransparent(uint8_t layer, KeyAddr key_addr) {
+  if (layer >= KALEIDOSCOPE_MAX_CACHED_LAYERS)
+    return (*getKey)(layer, key_addr) == Key_Transparent;
+
+  uint8_t i = key_addr.toInt();
+  return !bitRead(opaque_keys_[layer][i / 8], i % 8);
+}
+
+// Resolve a single key through the active layer stack, from the most recently
+// activated layer downwards.
+void Layer_::resolveActiveLayer(KeyAddr key_addr) {
+  uint8_t layer_index = active_layer_count_;
+  while (layer_index > 0) {
+    uint8_t layer = active_layers_[layer_index - 1];
+    if (!isTransparent(layer, key_addr)) {
+      setActiveLayer(key_addr, layer);
+      return;
+    }
+    layer_index--;
+  }
+  setActiveLayer(key_addr, 0);
+}
+
+// Every change to `active_layer_keymap_` goes through here, so that the key
+// indexes only need to look at the keys that changed.
+void Layer_::setActiveLayer(KeyAddr key_addr, uint8_t layer) {
+  if (active_layer_keymap_[key_addr.toInt()] == layer)
+    return;
+
+  active_layer_keymap_[key_addr.toInt()] = layer;
+  if (key_indexes_ != nullptr)
+    updateKeyIndexes(key_addr);
+}
+
+void Layer_::updateKeyIndexes(KeyAddr key_addr) {
+  Key key = lookupOnActiveLayer(key_addr);
+  for (KeyIndex *index = key_indexes_; index != nullptr; index = index->next_) {
+    index->update(key_addr, key);
+  }
+}
+
 void Layer_::updateActiveLayers(void) {
-  memset(active_layer_keymap_, 0, Runtime.device().numKeys());
+  updateTransparencyCache();
+
   for (auto key_addr : KeyAddr::all()) {
-    int8_t layer_index = active_layer_count_;
-    while (layer_index > 0) {
-      uint8_t layer = active_layers_[layer_index - 1];
-      if (Layer.isActive(layer)) {
-        Key mappedKey = (*getKey)(layer, key_addr);
-
-        if (mappedKey != Key_Transparent) {
-          active_layer_keymap_[key_addr.toInt()] = layer;
-          break;
-        }
-      }
-      layer_index--;
+    resolveActiveLayer(key_addr);
+  }
+
+  // The contents of the keymap may have changed too, not just the layers the
+  // keys come from, so the indexes are rebuilt in full.
+  if (key_indexes_ != nullptr) {
+    for (auto key_addr : KeyAddr::all()) {
+      updateKeyIndexes(key_addr);
     }
   }
 }
 
+void Layer_::addKeyIndex(KeyIndex &index) {
+  for (KeyIndex *i = key_indexes_; i != nullptr; i = i->next_) {
+    if (i == &index)
+      return;
+  }
+
+  index.next_ = key_indexes_;
+  key_indexes_ = &index;
+
+  for (auto key_addr : KeyAddr::all()) {
+    index.update(key_addr, lookupOnActiveLayer(key_addr));
+  }
+}
+
 void Layer_::move(uint8_t layer) {
   // We do pretty much what activate() does, except we do everything
   // unconditionally, to make sure all parts of the firmware are aware of the
@@ -161,7 +250,15 @@ void Layer_::move(uint8_t layer) {
   active_layer_count_ = 1;
   active_layers_[0] = layer;
 
-  updateActiveLayers();
+  if (transparencyCacheIsStale()) {
+    updateActiveLayers();
+  } else {
+    // With a single layer active, every key either comes from it, or falls
+    // back to layer 0.
+    for (auto key_addr : KeyAddr::all()) {
+      setActiveLayer(key_addr, isTransparent(layer, key_addr) ? 0 : layer);
+    }
+  }
 
   kaleidoscope::Hooks::onLayerChange();
 }
@@ -183,7 +280,17 @@ void Layer_::activate(uint8_t layer) {
 
   // Update the keymap cache (but not live_composite_keymap_; that gets
   // updated separately, when keys toggle on or off. See layers.h)
-  updateActiveLayers();
+  //
+  // The new layer is always on top of the stack, so the only keys that change
+  // are the ones that are not transparent on it.
+  if (transparencyCacheIsStale()) {
+    updateActiveLayers();
+  } else {
+    for (auto key_addr : KeyAddr::all()) {
+      if (!isTransparent(layer, key_addr))
+        setActiveLayer(key_addr, layer);
+    }
+  }
 
   kaleidoscope::Hooks::onLayerChange();
 }
@@ -200,17 +307,27 @@ void Layer_::deactivate(uint8_t layer) {
   // Rearrange the activation order array...
   uint8_t idx = 0;
   for (uint8_t i = active_layer_count_; i > 0; i--) {
-    if (active_layers_[i] == layer) {
-      idx = i;
+    if (active_layers_[i - 1] == layer) {
+      idx = i - 1;
       break;
     }
   }
-  memmove(&active_layers_[idx], &active_layers_[idx + 1], active_layer_count_ - idx);
+  memmove(&active_layers_[idx], &active_layers_[idx + 1], active_layer_count_ - idx - 1);
   active_layer_count_--;
 
   // Update the keymap cache (but not live_composite_keymap_; that gets
   // updated separately, when keys toggle on or off. See layers.h)
-  updateActiveLayers();
+  //
+  // Only the keys that were resolved to the deactivated layer need to be
+  // looked up again, all others stay where they are.
+  if (transparencyCacheIsStale()) {
+    updateActiveLayers();
+  } else {
+    for (auto key_addr : KeyAddr::all()) {
+      if (active_layer_keymap_[key_addr.toInt()] == layer)
+        resolveActiveLayer(key_addr);
+    }
+  }
 
   kaleidoscope::Hooks::onLayerChange();
 }
@@ -46,7 +46,92 @@
 
 extern uint8_t layer_count;
 
+// The number of layers for which `Layer` keeps a bitmap of non-transparent keys
+// in RAM. Layers above this limit still work, but their keys are looked up
+// through `Layer.getKey` whenever the active layer cache is updated.
+#ifndef KALEIDOSCOPE_MAX_CACHED_LAYERS
+#ifdef __AVR__
+#define KALEIDOSCOPE_MAX_CACHED_LAYERS 8
+#else
+#define KALEIDOSCOPE_MAX_CACHED_LAYERS 32
+#endif
+#endif
+
 namespace kaleidoscope {
+
+/* A `KeyIndex` tracks where the keys of a range are on the active layers (as
+ * seen by `Layer.lookupOnActiveLayer`). Plugins that need to know this, to
+ * light those keys up, for example, should keep one and register it with
+ * `Layer.addKeyIndex()` in their `onSetup()`, instead of looking up every key
+ * on every layer change. `Layer` keeps the registered indexes up to date,
+ * looking up only the keys whose active layer changed, once for all indexes.
+ *
+ * An index can be iterated over, yielding the addresses of matching keys:
+ *
+ *   for (auto key_addr : turbo_keys_) { ... }
+ */
+class KeyIndex {
+ public:
+  constexpr KeyIndex(Key first, Key last)
+    : first_(first), last_(last), keys_{}, next_(nullptr) {}
+  explicit constexpr KeyIndex(Key key)
+    : KeyIndex(key, key) {}
+
+  bool has(KeyAddr key_addr) const {
+    uint8_t i = key_addr.toInt();
+    return bitRead(keys_[i / 8], i % 8);
+  }
+
+  // The first matching key at or after `from`, or `KeyAddr::upper_limit` if
+  // there are none.
+  KeyAddr find(uint8_t from) const;
+
+  class Iterator {
+   public:
+    Iterator(const KeyIndex &index, KeyAddr key_addr)
+      : index_(index), key_addr_(key_addr) {}
+
+    KeyAddr operator*() const {
+      return key_addr_;
+    }
+    bool operator!=(const Iterator &other) const {
+      return key_addr_ != other.key_addr_;
+    }
+    Iterator &operator++() {
+      key_addr_ = index_.find(key_addr_.toInt() + 1);
+      return *this;
+    }
+
+   private:
+    const KeyIndex &index_;
+    KeyAddr key_addr_;
+  };
+
+  Iterator begin() const {
+    return Iterator(*this, find(0));
+  }
+  Iterator end() const {
+    return Iterator(*this, KeyAddr(KeyAddr::upper_limit));
+  }
+
+ private:
+  friend class Layer_;
+
+  static constexpr uint8_t keys_bytes_ = (kaleidoscope_internal::device.numKeys() + 7) / 8;
+
+  Key first_, last_;
+  uint8_t keys_[keys_bytes_];
+  KeyIndex *next_;
+
+  void update(KeyAddr key_addr, Key key) {
+    uint8_t i = key_addr.toInt();
+    if (key >= first_ && key <= last_)
+      bitSet(keys_[i / 8], i % 8);
+    else
+      bitClear(keys_[i / 8], i % 8);
+  }
+};
+
 class Layer_ {
  public:
   Layer_() {}
@@ -125,8 +210,20 @@ class Layer_ {
     live_composite_keymap_[key_addr.toInt()] = mappedKey;
   }
   static void updateLiveCompositeKeymap(KeyAddr key_addr);
+
+  /* `updateActiveLayers` rebuilds both the per-layer transparency cache, and
+   * the `active_layer_keymap_` from scratch. Layer changes do not need this,
+   * they update the cache incrementally, but anything that changes the
+   * contents of the keymap (such as uploading a new one to EEPROM) must call
+   * it afterwards.
+   */
   static void updateActiveLayers(void);
 
+  /* Registers a `KeyIndex` (see above), and fills it in. Registering the same
+   * index again does nothing.
+   */
+  static void addKeyIndex(KeyIndex &index);
+
  private:
   using forEachHandler = void(*)(uint8_t index, uint8_t layer);
 
@@ -140,6 +237,25 @@ class Layer_ {
   static Key live_composite_keymap_[kaleidoscope_internal::device.numKeys()];
   static uint8_t active_layer_keymap_[kaleidoscope_internal::device.numKeys()];
 
+  // One bit per key and layer, set if the key is not transparent on that
+  // layer. Together with the getKey function and the layer count it was built
+  // from, so we can tell when it went stale.
+  static constexpr uint8_t opaque_keys_bytes_ = (kaleidoscope_internal::device.numKeys() + 7) / 8;
+  static uint8_t opaque_keys_[KALEIDOSCOPE_MAX_CACHED_LAYERS][opaque_keys_bytes_];
+  static GetKeyFunction cached_get_key_;
+  static uint8_t cached_layer_count_;
+
+  static void updateTransparencyCache(void);
+  static bool transparencyCacheIsStale(void) {
+    return getKey != cached_get_key_ || layer_count != cached_layer_count_;
+  }
+  static bool isTransparent(uint8_t layer, KeyAddr key_addr);
+  static void resolveActiveLayer(KeyAddr key_addr);
+  static void setActiveLayer(KeyAddr key_addr, uint8_t layer);
+
+  static KeyIndex *key_indexes_;
+  static void updateKeyIndexes(KeyAddr key_addr);
+
   static void handleKeymapKeyswitchEvent(Key keymapEntry, uint8_t keyState);
 };
 }
@@ -33,6 +33,8 @@ class Cycle : public kaleidoscope::Plugin {
  public:
   Cycle(void) {}
 
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+
   static void replace(Key key);
   static void replace(uint8_t cycle_size, const Key cycle_steps[]);
 
@@ -22,10 +22,73 @@ namespace kaleidoscope {
 namespace plugin {
 uint16_t CycleTimeReport::last_report_time_;
 uint32_t CycleTimeReport::loop_start_time_;
+uint32_t CycleTimeReport::loop_time_sum_;
+uint16_t CycleTimeReport::loop_count_;
 uint32_t CycleTimeReport::average_loop_time;
+CycleTimeReport::Histogram CycleTimeReport::loop_time;
+CycleTimeReport::Histogram CycleTimeReport::phase_time[Runtime_::cycle_phase_count];
+
+void CycleTimeReport::Histogram::sample(uint32_t time) {
+  uint8_t index = 0;
+
+  if (time) {
+    index = sizeof(unsigned long) * 8 - __builtin_clzl(time);
+    if (index >= bucket_count)
+      index = bucket_count - 1;
+  }
+
+  // Rather than overflowing, halve every bucket, which keeps their proportions.
+  if (buckets_[index] == UINT16_MAX) {
+    for (uint8_t i = 0; i < bucket_count; i++)
+      buckets_[i] /= 2;
+  }
+  buckets_[index]++;
+
+  if (time > max_)
+    max_ = time;
+}
+
+void CycleTimeReport::Histogram::reset() {
+  memset(buckets_, 0, sizeof(buckets_));
+  max_ = 0;
+}
+
+uint32_t CycleTimeReport::Histogram::percentile(uint8_t percent) const {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < bucket_count; i++)
+    total += buckets_[i];
+
+  if (total == 0)
+    return 0;
+
+  uint32_t target = (total * percent + 99) / 100;
+  uint32_t seen = 0;
+  uint8_t index = 0;
+  for (; index < bucket_count - 1; index++) {
+    seen += buckets_[index];
+    if (seen >= target)
+      break;
+  }
+
+  if (index == 0)
+    return 0;
+
+  uint32_t bound = (1UL << index) - 1;
+  if (index == bucket_count - 1 || bound > max_)
+    return max_;
+  return bound;
+}
+
+void CycleTimeReport::reset() {
+  loop_time.reset();
+  for (uint8_t i = 0; i < Runtime_::cycle_phase_count; i++)
+    phase_time[i].reset();
+}
 
 EventHandlerResult CycleTimeReport::onSetup() {
   last_report_time_ = Runtime.millisAtCycleStart();
+  Runtime.enablePhaseTiming();
+  reset();
   return EventHandlerResult::OK;
 }
 
@@ -35,28 +98,89 @@ EventHandlerResult CycleTimeReport::beforeEachCycle() {
 }
 
 EventHandlerResult CycleTimeReport::afterEachCycle() {
-  uint32_t loop_time = micros() - loop_start_time_;
+  uint32_t loop_time_us = micros() - loop_start_time_;
 
-  if (average_loop_time)
-    average_loop_time = (average_loop_time + loop_time) / 2;
-  else
-    average_loop_time = loop_time;
+  loop_time.sample(loop_time_us);
+  for (uint8_t i = 0; i < Runtime_::cycle_phase_count; i++) {
+    uint32_t time = Runtime.phaseTime(static_cast<Runtime_::CyclePhase>(i));
+
+    // The LEDs are not synced on every cycle, and sampling the cycles where
+    // they were not would drown the ones where they were.
+    if (i == static_cast<uint8_t>(Runtime_::CyclePhase::LEDSync) && time == 0)
+      continue;
+    phase_time[i].sample(time);
+  }
+
+  loop_time_sum_ += loop_time_us;
+  loop_count_++;
 
   if (Runtime.hasTimeExpired(last_report_time_, uint16_t(1000))) {
+    average_loop_time = loop_time_sum_ / loop_count_;
     cycleTimeReport();
 
-    average_loop_time = 0;
+    loop_time_sum_ = 0;
+    loop_count_ = 0;
     last_report_time_ = Runtime.millisAtCycleStart();
   }
 
   return EventHandlerResult::OK;
 }
 
+EventHandlerResult CycleTimeReport::onFocusEvent(const char *command) {
+  enum {
+    STATS,
+    HISTOGRAM,
+    RESET,
+  } sub_command;
+
+  if (::Focus.handleHelp(command, PSTR("cycletime.stats\ncycletime.histogram\ncycletime.reset")))
+    return EventHandlerResult::OK;
+
+  if (strncmp_P(command, PSTR("cycletime."), 10) != 0)
+    return EventHandlerResult::OK;
+
+  if (strcmp_P(command + 10, PSTR("stats")) == 0)
+    sub_command = STATS;
+  else if (strcmp_P(command + 10, PSTR("histogram")) == 0)
+    sub_command = HISTOGRAM;
+  else if (strcmp_P(command + 10, PSTR("reset")) == 0)
+    sub_command = RESET;
+  else
+    return EventHandlerResult::OK;
+
+  // One line for the whole loop, then one for each phase, in the order of
+  // Runtime_::CyclePhase.
+  switch (sub_command) {
+  case STATS:
+    for (uint8_t i = 0; i <= Runtime_::cycle_phase_count; i++) {
+      const Histogram &h = i == 0 ? loop_time : phase_time[i - 1];
+      ::Focus.send(h.max(), h.percentile(50), h.percentile(95), h.percentile(99),
+                   ::Focus.NEWLINE);
+    }
+    break;
+  case HISTOGRAM:
+    for (uint8_t i = 0; i <= Runtime_::cycle_phase_count; i++) {
+      const Histogram &h = i == 0 ? loop_time : phase_time[i - 1];
+      for (uint8_t b = 0; b < Histogram::bucket_count; b++)
+        ::Focus.send(h.bucket(b));
+      ::Focus.send(::Focus.NEWLINE);
+    }
+    break;
+  case RESET:
+    reset();
+    break;
+  }
+
+  return EventHandlerResult::EVENT_CONSUMED;
+}
+
 }
 }
 
 __attribute__((weak)) void cycleTimeReport(void) {
   Focus.send(Focus.COMMENT, F("average loop time:"), CycleTimeReport.average_loop_time,
+             F("max:"), CycleTimeReport.loop_time.max(),
+             F("p99:"), CycleTimeReport.loop_time.percentile(99),
              Focus.NEWLINE);
 }
 
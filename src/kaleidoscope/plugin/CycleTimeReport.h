@@ -23,17 +23,50 @@ namespace kaleidoscope {
 namespace plugin {
 class CycleTimeReport : public kaleidoscope::Plugin {
  public:
+  // A histogram of times (in microseconds), with power-of-two sized buckets:
+  // bucket 0 counts zero, and bucket `i` counts times in `[2^(i-1), 2^i)`. The
+  // last bucket also collects everything longer than that.
+  class Histogram {
+   public:
+    static constexpr uint8_t bucket_count = 16;
+
+    void sample(uint32_t time);
+    void reset();
+
+    uint32_t max() const {
+      return max_;
+    }
+    uint16_t bucket(uint8_t index) const {
+      return buckets_[index];
+    }
+    // An upper bound on the `percent`th percentile: the end of the bucket the
+    // percentile falls into, capped at the maximum.
+    uint32_t percentile(uint8_t percent) const;
+
+   private:
+    uint16_t buckets_[bucket_count];
+    uint32_t max_;
+  };
+
   CycleTimeReport() {}
 
   EventHandlerResult onSetup();
   EventHandlerResult beforeEachCycle();
   EventHandlerResult afterEachCycle();
+  EventHandlerResult onFocusEvent(const char *command);
+
+  static void reset();
 
   static uint32_t average_loop_time;
 
+  static Histogram loop_time;
+  static Histogram phase_time[Runtime_::cycle_phase_count];
+
  private:
   static uint16_t last_report_time_;
   static uint32_t loop_start_time_;
+  static uint32_t loop_time_sum_;
+  static uint16_t loop_count_;
 };
 }
 }
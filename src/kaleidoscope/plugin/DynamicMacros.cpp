@@ -29,6 +29,19 @@ namespace kaleidoscope
     uint16_t DynamicMacros::storage_base_;
     uint16_t DynamicMacros::storage_size_;
     uint16_t DynamicMacros::map_[];
+    DynamicMacros::Step DynamicMacros::steps_[];
+    DynamicMacros::CachedMacro DynamicMacros::cached_[];
+    uint16_t DynamicMacros::cache_clock_;
+    bool DynamicMacros::playing_;
+    bool DynamicMacros::explicit_report_;
+    bool DynamicMacros::streaming_;
+    DynamicMacros::Decoder DynamicMacros::decoder_;
+    uint16_t DynamicMacros::step_index_;
+    uint16_t DynamicMacros::step_end_;
+    uint32_t DynamicMacros::wait_start_;
+    uint16_t DynamicMacros::wait_time_;
+    Key DynamicMacros::held_keys_[];
+    uint8_t DynamicMacros::held_key_count_;
 
     static void playMacroKeyswitchEvent(Key key, uint8_t keyswitch_state,
                                         bool explicit_report)
@@ -55,66 +68,6 @@ namespace kaleidoscope
       }
     }
 
-    static void readKeyCodeAndPlay(uint16_t pos, uint8_t flags, uint8_t keyStates,
-                                   bool explicit_report)
-    {
-      Key key(Runtime.storage().read(pos++), // key_code
-              flags);
-
-      playKeyCode(key, keyStates, explicit_report);
-    }
-
-    void customDelay(uint16_t time)
-    {
-      int c = (int)time / 1000;
-      int d = time % 1000;
-      while (c >= 0)
-      {
-        if (c == 0)
-        {
-          delay(d);
-          c -= 1;
-        }
-        else
-        {
-          delay(1000);
-          c -= 1;
-        }
-#ifdef ARDUINO_SAMD_RAISE
-        if (!WDT->STATUS.bit.SYNCBUSY) // Check if the WDT registers are synchronized
-        {
-          REG_WDT_CLEAR = WDT_CLEAR_CLEAR_KEY; // Clear the watchdog timer
-        }
-#endif
-      }
-    }
-
-    void randomDelay(uint16_t randomA, uint16_t randomB)
-    {
-      int rnd = random(randomA, randomB);
-      int c = (int)rnd / 1000;
-      int d = rnd % 1000;
-      while (c >= 0)
-      {
-        if (c == 0)
-        {
-          delay(d);
-          c -= 1;
-        }
-        else
-        {
-          delay(1000);
-          c -= 1;
-        }
-#ifdef ARDUINO_SAMD_RAISE
-        if (!WDT->STATUS.bit.SYNCBUSY) // Check if the WDT registers are synchronized
-        {
-          REG_WDT_CLEAR = WDT_CLEAR_CLEAR_KEY; // Clear the watchdog timer
-        }
-#endif
-      }
-    }
-
     void DynamicMacros::updateDynamicMacroCache(void)
     {
       uint16_t pos = storage_base_;
@@ -122,6 +75,7 @@ namespace kaleidoscope
       macro_t macro = MACRO_ACTION_END;
       bool previous_macro_ended = false;
 
+      clearCache();
       map_[0] = 0;
 
       while (pos < storage_base_ + storage_size_)
@@ -135,8 +89,6 @@ namespace kaleidoscope
           previous_macro_ended = false;
           break;
 
-        case MACRO_ACTION_STEP_INTERVAL:
-        case MACRO_ACTION_STEP_WAIT:
         case MACRO_ACTION_STEP_KEYCODEDOWN:
         case MACRO_ACTION_STEP_KEYCODEUP:
         case MACRO_ACTION_STEP_TAPCODE:
@@ -144,6 +96,12 @@ namespace kaleidoscope
           pos++;
           break;
 
+        case MACRO_ACTION_STEP_INTERVAL:
+          previous_macro_ended = false;
+          pos += 4;
+          break;
+
+        case MACRO_ACTION_STEP_WAIT:
         case MACRO_ACTION_STEP_KEYDOWN:
         case MACRO_ACTION_STEP_KEYUP:
         case MACRO_ACTION_STEP_TAP:
@@ -186,116 +144,302 @@ namespace kaleidoscope
       }
     }
 
-    void DynamicMacros::play(uint8_t macro_id)
+    // Keys pressed by a macro stay held until it releases them, or until it
+    // ends, even if that takes several cycles: the report is rebuilt every
+    // cycle, so we have to press them again each time.
+    void DynamicMacros::holdKey(Key key, uint8_t keyStates)
     {
-      macro_t macro = MACRO_ACTION_END;
-      uint16_t randomA = 0;
-      uint16_t randomB = 0;
-      uint16_t interval = 0;
-      uint8_t flags;
-      bool explicit_report = false;
-      uint16_t pos;
+      if (keyIsPressed(keyStates) && !keyWasPressed(keyStates))
+      {
+        if (held_key_count_ < max_held_keys_)
+          held_keys_[held_key_count_++] = key;
+        return;
+      }
 
-      pos = storage_base_ + map_[macro_id];
+      if (!keyIsPressed(keyStates) && keyWasPressed(keyStates))
+      {
+        for (uint8_t i = 0; i < held_key_count_; i++)
+        {
+          if (held_keys_[i] == key)
+          {
+            held_keys_[i] = held_keys_[--held_key_count_];
+            return;
+          }
+        }
+      }
+    }
+
+    void DynamicMacros::wait(uint16_t time)
+    {
+      wait_start_ = Runtime.millisAtCycleStart();
+      wait_time_ = time;
+    }
 
+    bool DynamicMacros::Decoder::next(Step &step)
+    {
       while (true)
       {
-        switch (macro = Runtime.storage().read(pos++))
+        // Second half of an interval: its upper bound.
+        if (pending == MACRO_ACTION_STEP_INTERVAL)
+        {
+          pending = 0;
+          step.type = MACRO_ACTION_STEP_INTERVAL;
+          step.hi = Runtime.storage().read(pos++);
+          step.lo = Runtime.storage().read(pos++);
+          return true;
+        }
+
+        if (pending == MACRO_ACTION_STEP_TAP_SEQUENCE ||
+            pending == MACRO_ACTION_STEP_TAP_CODE_SEQUENCE)
+        {
+          step.type = MACRO_ACTION_STEP_TAP;
+          step.hi = 0;
+          if (pending == MACRO_ACTION_STEP_TAP_SEQUENCE)
+            step.hi = Runtime.storage().read(pos++);
+          step.lo = Runtime.storage().read(pos++);
+          if (step.hi != 0 || step.lo != 0)
+            return true;
+          pending = 0;
+        }
+
+        step.type = Runtime.storage().read(pos++);
+        step.hi = 0;
+        step.lo = 0;
+
+        switch (step.type)
         {
         case MACRO_ACTION_STEP_EXPLICIT_REPORT:
-          explicit_report = true;
-          break;
         case MACRO_ACTION_STEP_IMPLICIT_REPORT:
-          explicit_report = false;
-          break;
         case MACRO_ACTION_STEP_SEND_REPORT:
-          kaleidoscope::Runtime.hid().keyboard().sendReport();
-          kaleidoscope::Runtime.hid().mouse().sendReport();
-          break;
+          return true;
+
         case MACRO_ACTION_STEP_INTERVAL:
-        {
-          uint8_t rnd1 = Runtime.storage().read(pos++);
-          uint8_t rnd2 = Runtime.storage().read(pos++);
-          uint8_t rnd3 = Runtime.storage().read(pos++);
-          uint8_t rnd4 = Runtime.storage().read(pos++);
-          randomA = (rnd1 << 8) | rnd2;
-          randomB = (rnd3 << 8) | rnd4;
-          randomDelay(randomA, randomB);
-          break;
-        }
+          pending = MACRO_ACTION_STEP_INTERVAL;
+          // fall through
         case MACRO_ACTION_STEP_WAIT:
-        {
-          uint8_t d2 = Runtime.storage().read(pos++);
-          uint8_t d1 = Runtime.storage().read(pos++);
-          uint16_t wait = (d2 << 8) | d1;
-          customDelay(wait);
-          break;
-        }
         case MACRO_ACTION_STEP_KEYDOWN:
-          flags = Runtime.storage().read(pos++);
-          readKeyCodeAndPlay(pos++, flags, IS_PRESSED, explicit_report);
-          break;
         case MACRO_ACTION_STEP_KEYUP:
-          flags = Runtime.storage().read(pos++);
-          readKeyCodeAndPlay(pos++, flags, WAS_PRESSED, explicit_report);
-          break;
         case MACRO_ACTION_STEP_TAP:
-          flags = Runtime.storage().read(pos++);
-          readKeyCodeAndPlay(pos++, flags, IS_PRESSED | WAS_PRESSED, false);
-          break;
+          step.hi = Runtime.storage().read(pos++);
+          step.lo = Runtime.storage().read(pos++);
+          return true;
 
         case MACRO_ACTION_STEP_KEYCODEDOWN:
-          readKeyCodeAndPlay(pos++, 0, IS_PRESSED, explicit_report);
-          break;
         case MACRO_ACTION_STEP_KEYCODEUP:
-          readKeyCodeAndPlay(pos++, 0, WAS_PRESSED, explicit_report);
-          break;
         case MACRO_ACTION_STEP_TAPCODE:
-          readKeyCodeAndPlay(pos++, 0, IS_PRESSED | WAS_PRESSED, false);
-          break;
+          step.type += MACRO_ACTION_STEP_KEYDOWN - MACRO_ACTION_STEP_KEYCODEDOWN;
+          step.lo = Runtime.storage().read(pos++);
+          return true;
 
         case MACRO_ACTION_STEP_TAP_SEQUENCE:
-        {
-          uint8_t keyCode;
-          do
-          {
-            flags = Runtime.storage().read(pos++);
-            keyCode = Runtime.storage().read(pos++);
-            playKeyCode(Key(keyCode, flags), IS_PRESSED | WAS_PRESSED, false);
-            customDelay(interval);
-          } while (!(flags == 0 && keyCode == 0));
-          break;
-        }
         case MACRO_ACTION_STEP_TAP_CODE_SEQUENCE:
-        {
-          uint8_t keyCode;
-          do
-          {
-            keyCode = Runtime.storage().read(pos++);
-            playKeyCode(Key(keyCode, 0), IS_PRESSED | WAS_PRESSED, false);
-            customDelay(interval);
-          } while (keyCode != 0);
+          pending = step.type;
           break;
+
+        default:
+          return false;
         }
+      }
+    }
 
-        case MACRO_ACTION_END:
+    void DynamicMacros::clearCache()
+    {
+      for (uint8_t i = 0; i < DYNAMIC_MACROS_CACHE_SLOTS; i++)
+        cached_[i].id = 0xff;
+    }
+
+    // Removes a macro from the cache, and moves the ones stored after it down,
+    // so that the free space is always at the end of `steps_`.
+    void DynamicMacros::evictMacro(uint8_t slot)
+    {
+      uint16_t start = cached_[slot].start;
+      uint16_t length = cached_[slot].length;
+      uint16_t end = 0;
+
+      cached_[slot].id = 0xff;
+
+      for (uint8_t i = 0; i < DYNAMIC_MACROS_CACHE_SLOTS; i++)
+      {
+        if (cached_[i].id == 0xff)
+          continue;
+        if (cached_[i].start > start)
+          cached_[i].start -= length;
+        if (cached_[i].start + cached_[i].length > end)
+          end = cached_[i].start + cached_[i].length;
+      }
+
+      if (end > start)
+        memmove(&steps_[start], &steps_[start + length],
+                (end - start) * sizeof(Step));
+    }
+
+    // Makes sure the macro is decoded in the cache, and points `step_index_`
+    // and `step_end_` at it. Returns false if it does not fit at all.
+    bool DynamicMacros::cacheMacro(uint8_t macro_id)
+    {
+      cache_clock_++;
+
+      uint8_t free_slot = 0xff;
+      uint16_t used = 0;
+      for (uint8_t i = 0; i < DYNAMIC_MACROS_CACHE_SLOTS; i++)
+      {
+        if (cached_[i].id == macro_id)
         {
-          if (::OneShot.isActive() && !::OneShot.isPressed())
-          {
-            ::OneShot.cancel(true);
-          }
-          return;
+          cached_[i].last_used = cache_clock_;
+          step_index_ = cached_[i].start;
+          step_end_ = cached_[i].start + cached_[i].length;
+          return true;
         }
-        default:
-          return;
+        if (cached_[i].id == 0xff)
+          free_slot = i;
+        else
+          used += cached_[i].length;
+      }
+
+      Decoder decoder = {uint16_t(storage_base_ + map_[macro_id]), 0};
+      Step step;
+      uint16_t length = 0;
+      while (decoder.next(step))
+      {
+        if (++length > DYNAMIC_MACROS_CACHE_STEPS)
+          return false;
+      }
+
+      while (free_slot == 0xff || DYNAMIC_MACROS_CACHE_STEPS - used < length)
+      {
+        uint8_t lru = 0xff;
+        for (uint8_t i = 0; i < DYNAMIC_MACROS_CACHE_SLOTS; i++)
+        {
+          if (cached_[i].id == 0xff)
+            continue;
+          if (lru == 0xff ||
+              uint16_t(cache_clock_ - cached_[i].last_used) >
+              uint16_t(cache_clock_ - cached_[lru].last_used))
+            lru = i;
         }
+        used -= cached_[lru].length;
+        evictMacro(lru);
+        free_slot = lru;
+      }
+
+      decoder = {uint16_t(storage_base_ + map_[macro_id]), 0};
+      for (uint16_t i = used; i < used + length; i++)
+        decoder.next(steps_[i]);
+
+      cached_[free_slot] = {macro_id, cache_clock_, used, length};
+      step_index_ = used;
+      step_end_ = used + length;
+      return true;
+    }
+
+    bool DynamicMacros::nextStep(Step &step)
+    {
+      if (streaming_)
+        return decoder_.next(step);
+
+      if (step_index_ >= step_end_)
+        return false;
+      step = steps_[step_index_++];
+      return true;
+    }
 
-        delay(interval);
-        if (!WDT->STATUS.bit.SYNCBUSY) // Check if the WDT registers are synchronized
+    // Plays the next step, and returns false if playback has to stop for this
+    // cycle: either because the macro ended, or because the step was a wait.
+    bool DynamicMacros::playStep()
+    {
+      Step step;
+
+      if (!nextStep(step))
+      {
+        if (::OneShot.isActive() && !::OneShot.isPressed())
         {
-          REG_WDT_CLEAR = WDT_CLEAR_CLEAR_KEY; // Clear the watchdog timer
+          ::OneShot.cancel(true);
         }
+        cancel();
+        return false;
+      }
+
+      switch (step.type)
+      {
+      case MACRO_ACTION_STEP_EXPLICIT_REPORT:
+        explicit_report_ = true;
+        break;
+      case MACRO_ACTION_STEP_IMPLICIT_REPORT:
+        explicit_report_ = false;
+        break;
+      case MACRO_ACTION_STEP_SEND_REPORT:
+        kaleidoscope::Runtime.hid().keyboard().sendReport();
+        kaleidoscope::Runtime.hid().mouse().sendReport();
+        break;
+      case MACRO_ACTION_STEP_INTERVAL:
+      {
+        Step upper;
+        nextStep(upper);
+        wait(random(step.time(), upper.time()));
+        return false;
+      }
+      case MACRO_ACTION_STEP_WAIT:
+        wait(step.time());
+        return false;
+      case MACRO_ACTION_STEP_KEYDOWN:
+        playKeyCode(step.key(), IS_PRESSED, explicit_report_);
+        holdKey(step.key(), IS_PRESSED);
+        break;
+      case MACRO_ACTION_STEP_KEYUP:
+        playKeyCode(step.key(), WAS_PRESSED, explicit_report_);
+        holdKey(step.key(), WAS_PRESSED);
+        break;
+      case MACRO_ACTION_STEP_TAP:
+        playKeyCode(step.key(), IS_PRESSED | WAS_PRESSED, false);
+        break;
+      }
+
+      return true;
+    }
+
+    void DynamicMacros::play(uint8_t macro_id)
+    {
+      cancel();
+
+      streaming_ = !cacheMacro(macro_id);
+      if (streaming_)
+        decoder_ = {uint16_t(storage_base_ + map_[macro_id]), 0};
+      playing_ = true;
+    }
+
+    void DynamicMacros::cancel()
+    {
+      playing_ = false;
+      explicit_report_ = false;
+      wait_time_ = 0;
+      held_key_count_ = 0;
+    }
+
+    EventHandlerResult DynamicMacros::beforeReportingState()
+    {
+      if (!playing_)
+        return EventHandlerResult::OK;
+
+      for (uint8_t i = 0; i < held_key_count_; i++)
+      {
+        handleKeyswitchEvent(held_keys_[i], UnknownKeyswitchLocation,
+                             IS_PRESSED | WAS_PRESSED | INJECTED);
+      }
+
+      if (wait_time_)
+      {
+        if (!Runtime.hasTimeExpired(wait_start_, wait_time_))
+          return EventHandlerResult::OK;
+        wait_time_ = 0;
+      }
+
+      for (uint8_t i = 0; i < max_steps_per_cycle_; i++)
+      {
+        if (!playStep())
+          break;
       }
+
+      return EventHandlerResult::OK;
     }
 
     EventHandlerResult DynamicMacros::onKeyswitchEvent(Key &mappedKey,
@@ -317,7 +461,7 @@ namespace kaleidoscope
 
     EventHandlerResult DynamicMacros::onFocusEvent(const char *command)
     {
-      if (::Focus.handleHelp(command, PSTR("macros.map\nmacros.trigger\nmacros.memory")))
+      if (::Focus.handleHelp(command, PSTR("macros.map\nmacros.trigger\nmacros.cancel\nmacros.memory")))
         return EventHandlerResult::OK;
 
       if (strncmp_P(command, PSTR("macros."), 7) != 0)
@@ -357,6 +501,11 @@ namespace kaleidoscope
         play(id);
       }
 
+      if (strcmp_P(command + 7, PSTR("cancel")) == 0)
+      {
+        cancel();
+      }
+
       if (strcmp_P(command + 7, PSTR("memory")) == 0)
       {
         if (::Focus.isEOL())
@@ -24,6 +24,20 @@
 
 #define DM(n) Key(kaleidoscope::ranges::DYNAMIC_MACRO_FIRST + n)
 
+// Number of decoded macro steps kept in RAM, three bytes each. Macros that do
+// not fit are played straight from storage.
+#ifndef DYNAMIC_MACROS_CACHE_STEPS
+#ifdef __AVR__
+#define DYNAMIC_MACROS_CACHE_STEPS 32
+#else
+#define DYNAMIC_MACROS_CACHE_STEPS 256
+#endif
+#endif
+
+#ifndef DYNAMIC_MACROS_CACHE_SLOTS
+#define DYNAMIC_MACROS_CACHE_SLOTS 8
+#endif
+
 namespace kaleidoscope {
 namespace plugin {
 
@@ -31,18 +45,89 @@ class DynamicMacros : public kaleidoscope::Plugin {
  public:
   DynamicMacros(void) {}
 
+  typedef kaleidoscope::key_routing::KeyRange<ranges::DYNAMIC_MACRO_FIRST,
+                                              ranges::DYNAMIC_MACRO_LAST> RoutedKeys;
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mappedKey, KeyAddr key_addr, uint8_t keyState);
   EventHandlerResult onFocusEvent(const char *command);
+  EventHandlerResult beforeReportingState();
 
   static void reserve_storage(uint16_t size);
 
   void play(uint8_t seq_id);
+  static void cancel();
+  static bool isPlaying() {
+    return playing_;
+  }
 
  private:
   static uint16_t storage_base_;
   static uint16_t storage_size_;
   static uint16_t map_[127];
   static void updateDynamicMacroCache(void);
+
+  // Playback state. Macros are played back a few steps per cycle, and waits
+  // are timers checked every cycle, so the keyboard keeps working while a
+  // macro is running.
+  static constexpr uint8_t max_steps_per_cycle_ = 8;
+  static constexpr uint8_t max_held_keys_ = 8;
+
+  // A decoded macro step. Key code steps are turned into key steps without
+  // flags, and tap sequences into a series of taps. Intervals take two steps,
+  // the second one holding the upper bound.
+  struct Step {
+    uint8_t type;
+    uint8_t hi;  // Key flags, or the high byte of a time
+    uint8_t lo;  // Key code, or the low byte of a time
+
+    Key key() const {
+      return Key(lo, hi);
+    }
+    uint16_t time() const {
+      return (hi << 8) | lo;
+    }
+  };
+
+  // Decodes the macro steps found in storage, one at a time.
+  struct Decoder {
+    uint16_t pos;
+    uint8_t pending;
+
+    bool next(Step &step);
+  };
+
+  // Decoded macros are cached in RAM, and when a new one does not fit, the
+  // least recently played ones are evicted.
+  struct CachedMacro {
+    uint8_t id;
+    uint16_t last_used;
+    uint16_t start;
+    uint16_t length;
+  };
+
+  static Step steps_[DYNAMIC_MACROS_CACHE_STEPS];
+  static CachedMacro cached_[DYNAMIC_MACROS_CACHE_SLOTS];
+  static uint16_t cache_clock_;
+
+  static bool playing_;
+  static bool explicit_report_;
+  static bool streaming_;
+  static Decoder decoder_;
+  static uint16_t step_index_;
+  static uint16_t step_end_;
+  static uint32_t wait_start_;
+  static uint16_t wait_time_;
+  static Key held_keys_[max_held_keys_];
+  static uint8_t held_key_count_;
+
+  static bool cacheMacro(uint8_t macro_id);
+  static void evictMacro(uint8_t slot);
+  static void clearCache();
+  static bool nextStep(Step &step);
+  static bool playStep();
+  static void wait(uint16_t time);
+  static void holdKey(Key key, uint8_t keyStates);
 };
 
 }
@@ -29,6 +29,9 @@ namespace kaleidoscope
     class DynamicSuperKeys : public kaleidoscope::Plugin
     {
     public:
+      typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+      typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
       typedef enum
       {
         Tap,
@@ -25,6 +25,8 @@ namespace plugin {
 
 class DynamicTapDance: public kaleidoscope::Plugin {
  public:
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+
   DynamicTapDance() {}
 
   EventHandlerResult onFocusEvent(const char *command);
@@ -42,6 +42,7 @@ void EEPROMKeymapProgrammer::nextState(void) {
   case WAIT_FOR_SOURCE_KEY:
     ::EEPROMKeymap.updateKey(update_position_, new_key_);
     Runtime.storage().commit();
+    Layer.updateActiveLayers();
     cancel();
     break;
   }
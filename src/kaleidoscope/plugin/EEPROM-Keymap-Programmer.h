@@ -38,6 +38,8 @@ class EEPROMKeymapProgrammer : public kaleidoscope::Plugin {
   static void nextState(void);
   static void cancel(void);
 
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state);
   EventHandlerResult onFocusEvent(const char *command);
 
@@ -41,6 +41,7 @@ void EEPROMKeymap::setup(uint8_t max) {
     Layer.getKey = getKeyExtended;
   }
   max_layers(max);
+  Layer.updateActiveLayers();
 }
 
 void EEPROMKeymap::max_layers(uint8_t max) {
@@ -111,6 +112,7 @@ EventHandlerResult EEPROMKeymap::onFocusEvent(const char *command) {
         layer_count += progmem_layers_;
         Layer.getKey = getKeyExtended;
       }
+      Layer.updateActiveLayers();
     }
     return EventHandlerResult::EVENT_CONSUMED;
   }
@@ -134,6 +136,14 @@ EventHandlerResult EEPROMKeymap::onFocusEvent(const char *command) {
     // we actually want.
     //
     dumpKeymap(max_layers_, static_cast<Key(*)(uint8_t, KeyAddr)>(getKey));
+  } else if (::Focus.isFrame()) {
+    // A binary frame carries a part of the keymap as it is laid out in
+    // storage: flags, then key code, for each key.
+    uint16_t size = (uint16_t)Runtime.device().numKeys() * max_layers_ * 2;
+    if (::Focus.readFrame(keymap_base_, size)) {
+      Runtime.storage().commit();
+      Layer.updateActiveLayers();
+    }
   } else {
     uint16_t i = 0;
 
@@ -145,6 +155,7 @@ EventHandlerResult EEPROMKeymap::onFocusEvent(const char *command) {
       i++;
     }
     Runtime.storage().commit();
+    Layer.updateActiveLayers();
   }
 
   return EventHandlerResult::EVENT_CONSUMED;
@@ -24,6 +24,8 @@ namespace kaleidoscope {
 namespace plugin {
 class EEPROMKeymap : public kaleidoscope::Plugin {
  public:
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+
   enum class Mode {
     CUSTOM,
     EXTEND
@@ -208,15 +208,18 @@ EventHandlerResult FocusEEPROMCommand::onFocusEvent(const char *command) {
   enum {
     CONTENTS,
     FREE,
+    STATS,
   } sub_command;
 
-  if (::Focus.handleHelp(command, PSTR("eeprom.contents\neeprom.free")))
+  if (::Focus.handleHelp(command, PSTR("eeprom.contents\neeprom.free\neeprom.stats")))
     return EventHandlerResult::OK;
 
   if (strcmp_P(command, PSTR("eeprom.contents")) == 0)
     sub_command = CONTENTS;
   else if (strcmp_P(command, PSTR("eeprom.free")) == 0)
     sub_command = FREE;
+  else if (strcmp_P(command, PSTR("eeprom.stats")) == 0)
+    sub_command = STATS;
   else
     return EventHandlerResult::OK;
 
@@ -233,6 +236,8 @@ EventHandlerResult FocusEEPROMCommand::onFocusEvent(const char *command) {
         ::Focus.read(d);
         Runtime.storage().update(i, d);
       }
+      Runtime.storage().commit();
+      Layer.updateActiveLayers();
     }
 
     break;
@@ -240,6 +245,11 @@ EventHandlerResult FocusEEPROMCommand::onFocusEvent(const char *command) {
   case FREE:
     ::Focus.send(Runtime.storage().length() - ::EEPROMSettings.used());
     break;
+  case STATS:
+    ::Focus.sendRaw(F("writes:"), Runtime.storage().writeCount(),
+                    F("\ncommits:"), Runtime.storage().commitCount(),
+                    F("\nerases:"), Runtime.storage().eraseCount());
+    break;
   }
 
   return EventHandlerResult::EVENT_CONSUMED;
@@ -25,6 +25,9 @@ class EscapeOneShot : public kaleidoscope::Plugin {
  public:
   EscapeOneShot(void) {}
 
+  typedef kaleidoscope::key_routing::KeyRange<Key_Escape.getRaw(),
+                                              Key_Escape.getRaw()> HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t keyState);
 
  private:
@@ -32,6 +32,8 @@ class FingerPainter : public LEDMode {
 
   static void toggle(void);
 
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state);
   EventHandlerResult onFocusEvent(const char *command);
   EventHandlerResult onSetup();
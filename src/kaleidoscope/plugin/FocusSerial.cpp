@@ -16,6 +16,8 @@
  */
 
 #include <Kaleidoscope-FocusSerial.h>
+#include "kaleidoscope/util/crc16.h"
+#include "kaleidoscope/hook_profiling.h"
 
 #ifdef __AVR__
 #include <avr/pgmspace.h>
@@ -25,6 +27,133 @@ namespace kaleidoscope {
 namespace plugin {
 
 char FocusSerial::command_[32];
+Stream *FocusSerial::input_;
+FocusSerial::Route FocusSerial::routes_[];
+uint8_t FocusSerial::route_count_;
+bool FocusSerial::routes_built_;
+uint8_t FocusSerial::collecting_plugin_ = FocusSerial::no_plugin;
+
+// FNV-1a, folded to 16 bits.
+static uint16_t hashStep(uint32_t &hash, char c) {
+  hash ^= (uint8_t)c;
+  hash *= 16777619UL;
+  return (hash >> 16) ^ (hash & 0xffff);
+}
+
+// Plugins usually claim every command under their prefix ("led.", "keymap.",
+// ...) with a single strncmp_P, so routes are keyed on the prefix - up to and
+// including the first dot - rather than on the whole command.
+static bool inPrefix(char c, bool &seen_dot) {
+  if (seen_dot)
+    return false;
+  seen_dot = (c == '.');
+  return true;
+}
+
+void FocusSerial::buildRoutes() {
+  char help[] = "help";
+
+  routes_built_ = true;
+
+  for (uint8_t i = 0; i < Hooks::pluginCount(); i++) {
+    collecting_plugin_ = i;
+    Hooks::onFocusEventFor(i, help);
+  }
+  collecting_plugin_ = no_plugin;
+}
+
+void FocusSerial::addRoutes(const char *help_message) {
+  const char *p = help_message;
+
+  while (pgm_read_byte(p)) {
+    uint32_t state = 2166136261UL;
+    uint16_t hash = 0;
+    bool seen_dot = false;
+    char c;
+    while ((c = pgm_read_byte(p)) != '\0' && c != '\n') {
+      if (inPrefix(c, seen_dot))
+        hash = hashStep(state, c);
+      p++;
+    }
+    if (c == '\n')
+      p++;
+
+    uint8_t pos = 0;
+    while (pos < route_count_ && routes_[pos].hash < hash)
+      pos++;
+
+    // Prefixes listed by more than one plugin (or colliding hashes belonging
+    // to different plugins) are sent to everyone, in order.
+    if (pos < route_count_ && routes_[pos].hash == hash) {
+      if (routes_[pos].plugin != collecting_plugin_)
+        routes_[pos].plugin = no_plugin;
+      continue;
+    }
+
+    if (route_count_ == FOCUS_SERIAL_MAX_ROUTES)
+      continue;
+
+    memmove(&routes_[pos + 1], &routes_[pos],
+            (route_count_ - pos) * sizeof(Route));
+    routes_[pos].hash = hash;
+    routes_[pos].plugin = collecting_plugin_;
+    route_count_++;
+  }
+}
+
+uint8_t FocusSerial::findRoute(const char *command) {
+  uint32_t state = 2166136261UL;
+  uint16_t hash = 0;
+  bool seen_dot = false;
+  for (const char *c = command; *c && inPrefix(*c, seen_dot); c++)
+    hash = hashStep(state, *c);
+
+  uint8_t lo = 0, hi = route_count_;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) / 2;
+    if (routes_[mid].hash < hash)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo < route_count_ && routes_[lo].hash == hash)
+    return routes_[lo].plugin;
+  return no_plugin;
+}
+
+// Sends the command to the only plugin that lists commands with its prefix, so
+// no other plugin could have claimed it first. If that one does not consume it
+// - on a hash collision, for example - everyone else gets it too, in order.
+void FocusSerial::dispatch(const char *command) {
+  if (!routes_built_)
+    buildRoutes();
+
+  uint8_t plugin = no_plugin;
+  if (strcmp_P(command, PSTR("help")) != 0)
+    plugin = findRoute(command);
+
+  if (plugin == no_plugin) {
+    Runtime.onFocusEvent(command);
+    return;
+  }
+
+  if (Hooks::onFocusEventFor(plugin, command) == EventHandlerResult::EVENT_CONSUMED)
+    return;
+
+  for (uint8_t i = 0; i < Hooks::pluginCount(); i++) {
+    if (i == plugin)
+      continue;
+    if (Hooks::onFocusEventFor(i, command) == EventHandlerResult::EVENT_CONSUMED)
+      return;
+  }
+}
+
+void FocusSerial::dispatch(const char *command, Stream &input) {
+  input_ = &input;
+  dispatch(command);
+  input_ = nullptr;
+}
 
 void FocusSerial::drain(void) {
   if (Runtime.serialPort().available())
@@ -48,7 +177,7 @@ EventHandlerResult FocusSerial::beforeReportingState() {
   else
     command_[i] = '\0';
 
-  Runtime.onFocusEvent(command_);
+  dispatch(command_);
 
   Runtime.serialPort().println(F("\r\n."));
 
@@ -65,15 +194,117 @@ bool FocusSerial::handleHelp(const char *command,
   if (strcmp_P(command, PSTR("help")) != 0)
     return false;
 
+  if (collecting_plugin_ != no_plugin) {
+    addRoutes(help_message);
+    return true;
+  }
+
   Runtime.serialPort().println((const __FlashStringHelper *)help_message);
   return true;
 }
 
 EventHandlerResult FocusSerial::onFocusEvent(const char *command) {
-  handleHelp(command, PSTR("help"));
+  if (handleHelp(command, PSTR("help\nprofile.hooks\nprofile.hid\nprofile.reset")))
+    return EventHandlerResult::OK;
+
+  if (strcmp_P(command, PSTR("profile.hooks")) == 0) {
+    printHookProfile();
+    return EventHandlerResult::EVENT_CONSUMED;
+  }
+  if (strcmp_P(command, PSTR("profile.hid")) == 0) {
+    auto &stats = Runtime.hid().keyboard().reportStats();
+    send(stats.sent, stats.suppressed, stats.failed);
+    return EventHandlerResult::EVENT_CONSUMED;
+  }
+  if (strcmp_P(command, PSTR("profile.reset")) == 0) {
+    hook_profiling::reset();
+    Runtime.hid().keyboard().resetReportStats();
+    return EventHandlerResult::EVENT_CONSUMED;
+  }
+
   return EventHandlerResult::OK;
 }
 
+// Prints the name at the start of a newline separated PROGMEM list.
+void FocusSerial::sendName(const char *names) {
+  char c;
+  while ((c = pgm_read_byte(names++)) != '\n')
+    Runtime.serialPort().print(c);
+  Runtime.serialPort().print(SEPARATOR);
+}
+
+// One line for every plugin and hook that was called: the plugin, the hook, the
+// number of calls, and the total and maximum time spent in it, in microseconds.
+// Without KALEIDOSCOPE_HOOK_PROFILING, there are no plugin names, and nothing
+// is printed.
+void FocusSerial::printHookProfile() {
+  const char *plugin_names = hook_profiling::pluginNames();
+
+  for (uint8_t p = 0; pgm_read_byte(plugin_names); p++) {
+    const char *hook_names = hook_profiling::hookNames();
+    const char *next_plugin = plugin_names;
+    while (pgm_read_byte(next_plugin++) != '\n') {}
+
+    for (uint8_t h = 0; h < hook_profiling::hook_count; h++) {
+      const hook_profiling::Entry *e = hook_profiling::entry(p, h);
+
+      if (e->count) {
+        sendName(plugin_names);
+        sendName(hook_names);
+        send(e->count, e->total, e->max, NEWLINE);
+      }
+      while (pgm_read_byte(hook_names++) != '\n') {}
+    }
+
+    plugin_names = next_plugin;
+  }
+}
+
+bool FocusSerial::readFrame(Stream &stream, uint16_t storage_base, uint16_t max_length) {
+  uint8_t header[5];
+  if (stream.readBytes(header, sizeof(header)) != sizeof(header))
+    return frameError();
+
+  uint16_t offset = header[1] | (header[2] << 8);
+  uint16_t length = header[3] | (header[4] << 8);
+  uint8_t payload[FOCUS_SERIAL_MAX_FRAME_LENGTH];
+  uint16_t crc = 0xffff;
+
+  for (uint8_t i = 1; i < sizeof(header); i++)
+    crc = _crc_ccitt_update(crc, header[i]);
+
+  // The payload is checked before any of it is stored. A frame that does not
+  // fit is still read to its end, so that it is not taken for the next
+  // command, but it is refused.
+  for (uint16_t left = length; left;) {
+    uint16_t n = left < sizeof(payload) ? left : sizeof(payload);
+    if (stream.readBytes(payload, n) != n)
+      return frameError();
+
+    for (uint16_t i = 0; i < n; i++)
+      crc = _crc_ccitt_update(crc, payload[i]);
+    left -= n;
+  }
+
+  uint8_t trailer[2];
+  if (stream.readBytes(trailer, sizeof(trailer)) != sizeof(trailer) ||
+      (trailer[0] | (trailer[1] << 8)) != crc)
+    return frameError();
+
+  if (length > sizeof(payload) || offset > max_length || length > max_length - offset)
+    return frameError();
+
+  for (uint16_t pos = 0; pos < length; pos++)
+    Runtime.storage().update(storage_base + offset + pos, payload[pos]);
+
+  return true;
+}
+
+bool FocusSerial::frameError(void) {
+  Runtime.serialPort().print(F("error"));
+  return false;
+}
+
 void FocusSerial::printBool(bool b) {
   Runtime.serialPort().print((b) ? F("true") : F("false"));
 }
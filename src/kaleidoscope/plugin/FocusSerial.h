@@ -19,6 +19,26 @@
 
 #include "kaleidoscope/Runtime.h"
 
+// Maximum number of commands in the routing table. Commands that do not fit are
+// sent to every plugin, like commands no plugin lists in its help.
+#ifndef FOCUS_SERIAL_MAX_ROUTES
+#ifdef __AVR__
+#define FOCUS_SERIAL_MAX_ROUTES 48
+#else
+#define FOCUS_SERIAL_MAX_ROUTES 128
+#endif
+#endif
+
+// Maximum payload length of a binary frame. Frames are checked in RAM before
+// anything is stored, so larger uploads are sent as several frames.
+#ifndef FOCUS_SERIAL_MAX_FRAME_LENGTH
+#ifdef __AVR__
+#define FOCUS_SERIAL_MAX_FRAME_LENGTH 64
+#else
+#define FOCUS_SERIAL_MAX_FRAME_LENGTH 256
+#endif
+#endif
+
 namespace kaleidoscope {
 namespace plugin {
 class FocusSerial : public kaleidoscope::Plugin {
@@ -58,31 +78,59 @@ class FocusSerial : public kaleidoscope::Plugin {
   }
 
   const char peek() {
-    return Runtime.serialPort().peek();
+    return input().peek();
   }
 
   void read(Key &key) {
-    key.setRaw(Runtime.serialPort().parseInt());
+    key.setRaw(input().parseInt());
   }
   void read(cRGB &color) {
-    color.r = Runtime.serialPort().parseInt();
-    color.g = Runtime.serialPort().parseInt();
-    color.b = Runtime.serialPort().parseInt();
+    color.r = input().parseInt();
+    color.g = input().parseInt();
+    color.b = input().parseInt();
   }
   void read(uint8_t &u8) {
-    u8 = Runtime.serialPort().parseInt();
+    u8 = input().parseInt();
   }
   void read(uint16_t &u16) {
-    u16 = Runtime.serialPort().parseInt();
+    u16 = input().parseInt();
   }
 
   bool isEOL() {
-    return Runtime.serialPort().peek() == '\n';
+    return input().peek() == '\n';
+  }
+
+  /* Binary frames
+   *
+   * Instead of a list of numbers, bulk setters can also accept a binary frame:
+   * a FRAME_START byte, the offset of the payload in the data the command sets
+   * and its length (16 bits each, little endian), the payload, and the
+   * CRC16-CCITT (initial value 0xffff, 16 bits, little endian) of the offset,
+   * length and payload. `readFrame` reads the frame into RAM, and writes the
+   * payload to storage, starting at `storage_base` + offset, only if the frame
+   * is complete and intact, and fits both FOCUS_SERIAL_MAX_FRAME_LENGTH and
+   * `max_length`. It returns whether it did; on failure, it reports an error
+   * to the host and storage is left untouched. Committing the storage, and
+   * acting on its new contents, is left to the caller.
+   */
+  bool isFrame() {
+    return input().peek() == FRAME_START;
+  }
+  bool readFrame(uint16_t storage_base, uint16_t max_length) {
+    return readFrame(input(), storage_base, max_length);
   }
+  // Reads the frame from `stream` instead of the serial port.
+  bool readFrame(Stream &stream, uint16_t storage_base, uint16_t max_length);
 
   static constexpr char COMMENT = '#';
   static constexpr char SEPARATOR = ' ';
   static constexpr char NEWLINE = '\n';
+  static constexpr char FRAME_START = 0x02;
+
+  // Sends `command` to the plugins, as if it came from the host. Any arguments
+  // are read from the serial port, or from `input`, if given.
+  static void dispatch(const char *command);
+  static void dispatch(const char *command, Stream &input);
 
   /* Hooks */
   EventHandlerResult beforeReportingState();
@@ -91,8 +139,39 @@ class FocusSerial : public kaleidoscope::Plugin {
  private:
   static char command_[32];
 
+  // Where arguments are read from: the serial port, unless dispatch() was
+  // given another stream.
+  static Stream *input_;
+  static Stream &input() {
+    if (input_)
+      return *input_;
+    return Runtime.serialPort();
+  }
+
+  // Command routing: the prefixes of the commands each plugin lists in its
+  // help are collected into a table, sorted by hash, the first time a command
+  // arrives. Commands whose prefix belongs to a single plugin are sent to it
+  // directly, instead of walking the whole plugin chain.
+  struct Route {
+    uint16_t hash;
+    uint8_t plugin;
+  };
+  static constexpr uint8_t no_plugin = 0xff;
+
+  static Route routes_[FOCUS_SERIAL_MAX_ROUTES];
+  static uint8_t route_count_;
+  static bool routes_built_;
+  static uint8_t collecting_plugin_;
+
+  static void buildRoutes();
+  static void addRoutes(const char *help_message);
+  static uint8_t findRoute(const char *command);
+
   static void drain(void);
   static void printBool(bool b);
+  static void sendName(const char *names);
+  void printHookProfile();
+  static bool frameError(void);
 };
 }
 }
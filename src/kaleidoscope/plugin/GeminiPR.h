@@ -29,6 +29,9 @@ class GeminiPR : public kaleidoscope::Plugin {
  public:
   GeminiPR(void) {}
 
+  typedef kaleidoscope::key_routing::KeyRange<kaleidoscope::ranges::STENO_FIRST,
+                                              kaleidoscope::ranges::STENO_LAST> RoutedKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t keyState);
  private:
   static uint8_t keys_held_;
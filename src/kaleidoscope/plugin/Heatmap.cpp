@@ -18,6 +18,7 @@
 #include "kaleidoscope/Runtime.h"
 #include <Kaleidoscope-Heatmap.h>
 #include <Kaleidoscope-LEDControl.h>
+#include <Kaleidoscope-EEPROM-Settings.h>
 #include "kaleidoscope/keyswitch_state.h"
 
 namespace kaleidoscope {
@@ -32,25 +33,43 @@ const cRGB *Heatmap::heat_colors = heat_colors_default_;
 uint8_t Heatmap::heat_colors_length = 4;
 // number of millisecond to wait between each heatmap computation
 uint16_t Heatmap::update_delay = 1000;
+// number of seconds after which every count is halved (0 to never decay)
+uint16_t Heatmap::decay_delay = 0;
+bool Heatmap::persistent_;
+uint16_t Heatmap::settings_base_;
+// number of seconds to wait between saving the counts to storage
+uint16_t PersistentHeatmap::save_delay = 600;
 
 Heatmap::TransientLEDMode::TransientLEDMode(const Heatmap *parent)
   : // store the number of times each key has been strock
     heatmap_{},
+    // the color level each key was last set to
+    levels_{},
+    color_lut_{},
+    // heat_colors the color LUT was built from
+    lut_colors_(nullptr),
+    lut_colors_length_(0),
     // max of heatmap_ (we divide by it so we start at 1)
     highest_(1),
     // last heatmap computation time
-    last_heatmap_comp_time_(Runtime.millisAtCycleStart())
-{}
+    last_heatmap_comp_time_(Runtime.millisAtCycleStart()),
+    last_decay_time_(Runtime.millisAtCycleStart()),
+    last_save_time_(Runtime.millisAtCycleStart()),
+    dirty_(false) {
+  if (persistent_)
+    load();
+}
 
-cRGB Heatmap::TransientLEDMode::computeColor(float v) {
-  // compute the color corresponding to a value between 0 and 1
+void Heatmap::TransientLEDMode::buildColorLUT() {
+  // compute the color of each level, interpolating between the two closest
+  // heat_colors
 
   /*
    * for exemple, if:
-   *   v=0.8
+   *   level=25 (out of 0..31), which is a value of 25/31 = 0.8
    *   heat_colors_lenth=4 (hcl)
    *   the red components of heat_colors are: 0, 25, 25, 255 (rhc)
-   * the red component returned by computeColor will be: 117
+   * the red component of the level will be: 117
    *
    * 255 |                 /
    *     |                /
@@ -68,50 +87,80 @@ cRGB Heatmap::TransientLEDMode::computeColor(float v) {
    *                  fb
    *
    * in this exemple, I call red heat_colors: rhc
-   * idx1 = floor(v×(hcl-1)) = floor(0.8×3) = floor(2.4) = 2
+   * pos = level×(hcl-1)×256/31 = 25×3×256/31 = 619 (2.4 in 8.8 fixed point)
+   * idx1 = pos/256 = 2
    * idx2 = idx1 + 1 = 3
-   * fb = v×(hcl-1)-idx1 = 0.8×3 - 2 = 0.4
-   * red = (rhc[idx2]-rhc[idx1])×fb + rhc[idx1] = (255-25)×(2.4-2) + 25 = 117
+   * fb = pos%256 = 107 (0.4×256)
+   * red = (rhc[idx1]×(256-fb) + rhc[idx2]×fb)/256 = (25×149 + 255×107)/256 = 121
    */
 
-  float fb = 0;
-  uint8_t idx1, idx2;
-
-  if (v <= 0) {
-    // if v = 0, don't bother computing fb and use heat_colors[0]
-    idx1 = idx2 = 0;
-  } else if (v >= 1) {
-    // if v = 1,
-    // don't bother computing fb and use heat_colors[heat_colors_length-1]
-    idx1 = idx2 = heat_colors_length - 1;
-  } else {
-    float val = v * (heat_colors_length - 1);
-    // static_cast from float to int just drop the decimal part of the number
-    // static_cast<int>(5.9) → 5
-    idx1 = static_cast<int>(val);
-    idx2 = idx1 + 1;
-    fb = val - static_cast<float>(idx1);
-  }
+  lut_colors_ = heat_colors;
+  lut_colors_length_ = heat_colors_length;
+
+  for (uint8_t level = 0; level < color_levels_; level++) {
+    uint16_t pos = static_cast<uint32_t>(level) * (heat_colors_length - 1) * 256 / (color_levels_ - 1);
+    uint8_t idx1 = pos >> 8;
+    uint8_t fb = pos & 0xff;
+    // the last level uses heat_colors[heat_colors_length-1] as-is
+    uint8_t idx2 = (idx1 + 1 < heat_colors_length) ? idx1 + 1 : idx1;
 
-  uint8_t r = static_cast<uint8_t>((pgm_read_byte(&(heat_colors[idx2].r)) - pgm_read_byte(&(heat_colors[idx1].r))) * fb + pgm_read_byte(&(heat_colors[idx1].r)));
-  uint8_t g = static_cast<uint8_t>((pgm_read_byte(&(heat_colors[idx2].g)) - pgm_read_byte(&(heat_colors[idx1].g))) * fb + pgm_read_byte(&(heat_colors[idx1].g)));
-  uint8_t b = static_cast<uint8_t>((pgm_read_byte(&(heat_colors[idx2].b)) - pgm_read_byte(&(heat_colors[idx1].b))) * fb + pgm_read_byte(&(heat_colors[idx1].b)));
+    color_lut_[level].r = (pgm_read_byte(&(heat_colors[idx1].r)) * (256 - fb) + pgm_read_byte(&(heat_colors[idx2].r)) * fb) >> 8;
+    color_lut_[level].g = (pgm_read_byte(&(heat_colors[idx1].g)) * (256 - fb) + pgm_read_byte(&(heat_colors[idx2].g)) * fb) >> 8;
+    color_lut_[level].b = (pgm_read_byte(&(heat_colors[idx1].b)) * (256 - fb) + pgm_read_byte(&(heat_colors[idx2].b)) * fb) >> 8;
+  }
 
-  return {b, g, r};
+  // every key needs to be recolored with the new colors
+  for (auto key_addr : KeyAddr::all()) {
+    levels_[key_addr.toInt()] = no_level_;
+  }
 }
 
 void Heatmap::TransientLEDMode::shiftStats(void) {
   // this method is called when:
   // 1. a value in heatmap_ reach INT8_MAX
   // 2. highest_ reach heat_colors_length*512 (see Heatmap::loopHook)
+  // 3. decay_delay seconds elapsed since the last decay
 
   // we divide every heatmap element by 2
   for (auto key_addr : KeyAddr::all()) {
     heatmap_[key_addr.toInt()] = heatmap_[key_addr.toInt()] >> 1;
   }
 
-  // and also divide highest_ accordingly
+  // and also divide highest_ accordingly (we divide by it, so keep it above 0)
   highest_ = highest_ >> 1;
+  if (highest_ == 0)
+    highest_ = 1;
+
+  dirty_ = true;
+}
+
+void Heatmap::TransientLEDMode::load() {
+  Runtime.storage().get(settings_base_, heatmap_);
+
+  // counts never reach INT16_MAX, so anything above it means the storage is
+  // uninitialized (or holds something else): start from scratch then
+  highest_ = 1;
+  for (auto key_addr : KeyAddr::all()) {
+    if (heatmap_[key_addr.toInt()] >= INT16_MAX) {
+      resetMap();
+      return;
+    }
+    if (heatmap_[key_addr.toInt()] > highest_)
+      highest_ = heatmap_[key_addr.toInt()];
+  }
+}
+
+void Heatmap::TransientLEDMode::save() {
+  last_save_time_ = Runtime.millisAtCycleStart();
+
+  if (!dirty_)
+    return;
+
+  // only the cells that changed are written, and only once every save_delay
+  // seconds, to spare the storage from a write on every keypress
+  Runtime.storage().put(settings_base_, heatmap_);
+  Runtime.storage().commit();
+  dirty_ = false;
 }
 
 void Heatmap::resetMap(void) {
@@ -131,6 +180,7 @@ void Heatmap::TransientLEDMode::resetMap() {
   }
 
   highest_ = 1;
+  dirty_ = true;
 }
 
 EventHandlerResult Heatmap::onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
@@ -159,6 +209,7 @@ EventHandlerResult Heatmap::onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr,
 EventHandlerResult Heatmap::TransientLEDMode::onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
   // increment the heatmap_ value related to the key
   heatmap_[key_addr.toInt()]++;
+  dirty_ = true;
 
   // check highest_
   if (highest_ < heatmap_[key_addr.toInt()]) {
@@ -198,9 +249,62 @@ EventHandlerResult Heatmap::TransientLEDMode::beforeEachCycle() {
   if (highest_ > (static_cast<uint16_t>(heat_colors_length) << 9))
     shiftStats();
 
+  // let older key presses count for less and less: halve every count every
+  // decay_delay seconds
+  if (decay_delay != 0 &&
+      Runtime.millisAtCycleStart() - last_decay_time_ >= decay_delay * 1000UL) {
+    last_decay_time_ = Runtime.millisAtCycleStart();
+    shiftStats();
+  }
+
+  if (persistent_ &&
+      Runtime.millisAtCycleStart() - last_save_time_ >= PersistentHeatmap::save_delay * 1000UL)
+    save();
+
   return EventHandlerResult::OK;
 }
 
+void Heatmap::TransientLEDMode::recolor(bool all) {
+  if (lut_colors_ != heat_colors || lut_colors_length_ != heat_colors_length)
+    buildColorLUT();
+
+  // how much each key was pressed compared to the others, as a color level:
+  // level = heatmap_ × (color_levels_ - 1) / highest_, with the division done
+  // once, as a 16.16 fixed point multiplier (highest_ can't be equal to 0).
+  // It is rounded up, so that the hottest key does reach the last level.
+  uint32_t scale = ((static_cast<uint32_t>(color_levels_ - 1) << 16) + highest_ - 1) / highest_;
+
+  for (auto key_addr : KeyAddr::all()) {
+    uint8_t level = (heatmap_[key_addr.toInt()] * scale) >> 16;
+
+    // only touch the LEDs of keys whose color changed
+    if (!all && level == levels_[key_addr.toInt()])
+      continue;
+
+    levels_[key_addr.toInt()] = level;
+    ::LEDControl.setCrgbAt(key_addr, color_lut_[level]);
+  }
+}
+
+void Heatmap::TransientLEDMode::onActivate(void) {
+  recolor(true);
+}
+
+void Heatmap::TransientLEDMode::onDeactivate(void) {
+  // the counts go away with this instance, and are loaded back from storage
+  // when the mode is activated again: save them now, so none are lost
+  if (persistent_)
+    save();
+}
+
+void Heatmap::TransientLEDMode::refreshAt(KeyAddr key_addr) {
+  uint8_t level = levels_[key_addr.toInt()];
+  if (level == no_level_)
+    return;
+
+  ::LEDControl.setCrgbAt(key_addr, color_lut_[level]);
+}
+
 void Heatmap::TransientLEDMode::update(void) {
   if (!Runtime.has_leds)
     return;
@@ -216,22 +320,18 @@ void Heatmap::TransientLEDMode::update(void) {
   // schedule the next heatmap computing
   last_heatmap_comp_time_ = Runtime.millisAtCycleStart();
 
-  // for each key
-  for (auto key_addr : KeyAddr::all()) {
-    // how much the key was pressed compared to the others (between 0 and 1)
-    // (total_keys_ can't be equal to 0)
-    float v = static_cast<float>(heatmap_[key_addr.toInt()]) / highest_;
-    // we could have used an interger instead of a float, but then we would
-    // have had to change some multiplication in division.
-    // / on uint is slower than * on float, so I stay with the float
-    // https://forum.arduino.cc/index.php?topic=92684.msg2733723#msg2733723
-
-    // set the LED color accordingly
-    ::LEDControl.setCrgbAt(KeyAddr(key_addr), computeColor(v));
-  }
+  recolor(false);
+}
+
+EventHandlerResult PersistentHeatmap::onSetup() {
+  settings_base_ = ::EEPROMSettings.requestSlice(sizeof(uint16_t) * Runtime.device().numKeys());
+  persistent_ = true;
+
+  return EventHandlerResult::OK;
 }
 
 }
 }
 
 kaleidoscope::plugin::Heatmap HeatmapEffect;
+kaleidoscope::plugin::PersistentHeatmap PersistentHeatmapEffect;
@@ -29,6 +29,7 @@ class Heatmap : public Plugin,
   Heatmap(void) {}
 
   static uint16_t update_delay;
+  static uint16_t decay_delay;
   static const cRGB *heat_colors;
   static uint8_t heat_colors_length;
   void resetMap(void);
@@ -53,21 +54,53 @@ class Heatmap : public Plugin,
 
    protected:
 
+    void onActivate(void) final;
+    void onDeactivate(void) final;
     void update() final;
+    void refreshAt(KeyAddr key_addr) final;
 
    private:
 
+    // The number of distinct colors a key can have. Each key's share of the
+    // hottest key's count is mapped to one of these levels, and the colors
+    // for all of them are computed from `heat_colors` in advance.
+    static constexpr uint8_t color_levels_ = 32;
+    static constexpr uint8_t no_level_ = 0xff;
+
     uint16_t heatmap_[Runtime.device().numKeys()];
+    uint8_t levels_[Runtime.device().numKeys()];
+    cRGB color_lut_[color_levels_];
+    const cRGB *lut_colors_;
+    uint8_t lut_colors_length_;
     uint16_t highest_;
     uint16_t last_heatmap_comp_time_;
+    uint32_t last_decay_time_;
+    uint32_t last_save_time_;
+    bool dirty_;
 
     void shiftStats(void);
-    cRGB computeColor(float v);
+    void buildColorLUT(void);
+    void recolor(bool all);
+    void load(void);
+    void save(void);
 
     friend class Heatmap;
   };
+
+ protected:
+  static bool persistent_;
+  static uint16_t settings_base_;
 };
+
+class PersistentHeatmap : public Heatmap {
+ public:
+  static uint16_t save_delay;
+
+  EventHandlerResult onSetup();
+};
+
 }
 }
 
 extern kaleidoscope::plugin::Heatmap HeatmapEffect;
+extern kaleidoscope::plugin::PersistentHeatmap PersistentHeatmapEffect;
@@ -32,6 +32,8 @@ class IdleLEDs: public kaleidoscope::Plugin {
   static uint32_t idleTimeoutSeconds();
   static void setIdleTimeoutSeconds(uint32_t new_limit);
 
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   EventHandlerResult beforeEachCycle();
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state);
 
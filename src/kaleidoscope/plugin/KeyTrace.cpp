@@ -0,0 +1,106 @@
+/* -*- mode: c++ -*-
+ * Kaleidoscope-KeyTrace -- Record key event traces over serial
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Kaleidoscope-KeyTrace.h>
+#include <Kaleidoscope-FocusSerial.h>
+#include "kaleidoscope/key_trace.h"
+#include "kaleidoscope/keyswitch_state.h"
+
+namespace kaleidoscope {
+namespace plugin {
+
+bool KeyTrace::recording_;
+uint32_t KeyTrace::last_event_time_;
+Print *KeyTrace::output_;
+
+void KeyTrace::start() {
+  start(Runtime.serialPort());
+}
+
+void KeyTrace::start(Print &output) {
+  uint8_t header[key_trace::header_size];
+
+  output_ = &output;
+  key_trace::writeHeader(header, KeyAddr::upper_limit);
+  output_->write(header, sizeof(header));
+
+  last_event_time_ = Runtime.millisAtCycleStart();
+  recording_ = true;
+}
+
+void KeyTrace::stop() {
+  recording_ = false;
+}
+
+EventHandlerResult KeyTrace::onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
+  if (!recording_ || (key_state & INJECTED) || !key_addr.isValid())
+    return EventHandlerResult::OK;
+  if (!keyToggledOn(key_state) && !keyToggledOff(key_state))
+    return EventHandlerResult::OK;
+
+  uint8_t record[key_trace::record_size];
+  uint32_t delta = Runtime.millisAtCycleStart() - last_event_time_;
+
+  last_event_time_ = Runtime.millisAtCycleStart();
+
+  while (delta > key_trace::max_delta) {
+    key_trace::writeRecord(record, key_trace::max_delta, key_trace::idle_key, false);
+    output_->write(record, sizeof(record));
+    delta -= key_trace::max_delta;
+  }
+
+  key_trace::writeRecord(record, delta, key_addr.toInt(), keyToggledOn(key_state));
+  output_->write(record, sizeof(record));
+
+  return EventHandlerResult::OK;
+}
+
+EventHandlerResult KeyTrace::onFocusEvent(const char *command) {
+  enum {
+    START,
+    STOP,
+  } sub_command;
+
+  if (::Focus.handleHelp(command, PSTR("keytrace.start\nkeytrace.stop")))
+    return EventHandlerResult::OK;
+
+  if (strncmp_P(command, PSTR("keytrace."), 9) != 0)
+    return EventHandlerResult::OK;
+
+  if (strcmp_P(command + 9, PSTR("start")) == 0)
+    sub_command = START;
+  else if (strcmp_P(command + 9, PSTR("stop")) == 0)
+    sub_command = STOP;
+  else
+    return EventHandlerResult::OK;
+
+  switch (sub_command) {
+  case START:
+    start();
+    break;
+  case STOP:
+    stop();
+    break;
+  }
+
+  return EventHandlerResult::EVENT_CONSUMED;
+}
+
+}
+}
+
+kaleidoscope::plugin::KeyTrace KeyTrace;
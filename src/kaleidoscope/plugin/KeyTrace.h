@@ -0,0 +1,50 @@
+/* -*- mode: c++ -*-
+ * Kaleidoscope-KeyTrace -- Record key event traces over serial
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "kaleidoscope/Runtime.h"
+
+namespace kaleidoscope {
+namespace plugin {
+
+class KeyTrace : public kaleidoscope::Plugin {
+ public:
+  KeyTrace() {}
+
+  // Writes the trace header, and streams every keyswitch toggle from then on,
+  // to the serial port, or to `output`, if given.
+  static void start();
+  static void start(Print &output);
+  static void stop();
+  static bool recording() {
+    return recording_;
+  }
+
+  EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state);
+  EventHandlerResult onFocusEvent(const char *command);
+
+ private:
+  static bool recording_;
+  static uint32_t last_event_time_;
+  static Print *output_;
+};
+
+}
+}
+
+extern kaleidoscope::plugin::KeyTrace KeyTrace;
@@ -26,12 +26,25 @@ KeyAddr ActiveModColorEffect::mod_keys_[MAX_MODS_PER_LAYER];
 uint8_t ActiveModColorEffect::mod_key_count_;
 bool ActiveModColorEffect::highlight_normal_modifiers_ = true;
 
+KeyIndex ActiveModColorEffect::oneshot_keys_(Key(ranges::OS_FIRST), Key(ranges::OS_LAST));
+KeyIndex ActiveModColorEffect::modifier_keys_(Key_LeftControl, Key_RightGui);
+KeyIndex ActiveModColorEffect::layer_keys_(Key(0, SYNTHETIC | SWITCH_TO_KEYMAP),
+    Key(0xff, SYNTHETIC | SWITCH_TO_KEYMAP));
+
 cRGB ActiveModColorEffect::highlight_color = (cRGB) {
   160, 160, 160
 };
 
 cRGB ActiveModColorEffect::sticky_color = CRGB(160, 0, 0);
 
+EventHandlerResult ActiveModColorEffect::onSetup() {
+  Layer.addKeyIndex(oneshot_keys_);
+  Layer.addKeyIndex(modifier_keys_);
+  Layer.addKeyIndex(layer_keys_);
+
+  return onLayerChange();
+}
+
 EventHandlerResult ActiveModColorEffect::onLayerChange() {
   if (!Runtime.has_leds)
     return EventHandlerResult::OK;
@@ -39,12 +52,9 @@ EventHandlerResult ActiveModColorEffect::onLayerChange() {
   mod_key_count_ = 0;
 
   for (auto key_addr : KeyAddr::all()) {
-    Key k = Layer.lookupOnActiveLayer(key_addr);
-
-    if (::OneShot.isOneShotKey(k) ||
-        (highlight_normal_modifiers_ && (
-           (k >= Key_LeftControl && k <= Key_RightGui) ||
-           (k.getFlags() == (SYNTHETIC | SWITCH_TO_KEYMAP))))) {
+    if (oneshot_keys_.has(key_addr) ||
+        (highlight_normal_modifiers_ && (modifier_keys_.has(key_addr) ||
+                                         layer_keys_.has(key_addr)))) {
       mod_keys_[mod_key_count_++] = key_addr;
     }
   }
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "kaleidoscope/Runtime.h"
+#include "kaleidoscope/layers.h"
 #include <Kaleidoscope-LEDControl.h>
 
 #define MAX_MODS_PER_LAYER 16
@@ -37,14 +38,16 @@ class ActiveModColorEffect : public kaleidoscope::Plugin {
 
   EventHandlerResult beforeReportingState();
   EventHandlerResult onLayerChange();
-  EventHandlerResult onSetup() {
-    return onLayerChange();
-  }
+  EventHandlerResult onSetup();
 
  private:
   static bool highlight_normal_modifiers_;
   static KeyAddr mod_keys_[MAX_MODS_PER_LAYER];
   static uint8_t mod_key_count_;
+
+  static KeyIndex oneshot_keys_;
+  static KeyIndex modifier_keys_;
+  static KeyIndex layer_keys_;
 };
 }
 }
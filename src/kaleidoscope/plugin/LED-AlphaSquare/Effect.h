@@ -30,6 +30,9 @@ class AlphaSquareEffect : public Plugin,
 
   static uint16_t length;
 
+  typedef kaleidoscope::key_routing::KeyRange<Key_A.getRaw(),
+                                              Key_0.getRaw()> HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mappedKey, KeyAddr key_addr, uint8_t keyState);
 
   // This class' instance has dynamic lifetime
@@ -164,6 +164,16 @@ EventHandlerResult LEDPaletteTheme::themeFocusEvent(const char *command,
     return EventHandlerResult::EVENT_CONSUMED;
   }
 
+  if (::Focus.isFrame()) {
+    // A binary frame carries a part of the packed palette indexes, two per
+    // byte, as they are laid out in storage.
+    if (::Focus.readFrame(theme_base, max_index)) {
+      Runtime.storage().commit();
+      ::LEDControl.refreshAll();
+    }
+    return EventHandlerResult::EVENT_CONSUMED;
+  }
+
   uint16_t pos = 0;
 
   while (!::Focus.isEOL() && (pos < max_index)) {
@@ -39,6 +39,8 @@ class StalkerEffect : public Plugin,
   static uint16_t step_length;
   static cRGB inactive_color;
 
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t keyState);
 
   // This class' instance has dynamic lifetime
@@ -34,6 +34,8 @@ class WavepoolEffect : public Plugin,
  public:
   WavepoolEffect(void) {}
 
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state);
 
   // ms before idle animation starts after last keypress
@@ -145,7 +145,15 @@ namespace kaleidoscope
       if (!enabled_)
         return;
 
+      if (!Runtime.phaseTimingEnabled())
+      {
+        Runtime.device().syncLeds();
+        return;
+      }
+
+      uint32_t start = micros();
       Runtime.device().syncLeds();
+      Runtime.addPhaseTime(Runtime_::CyclePhase::LEDSync, micros() - start);
     }
 
     kaleidoscope::EventHandlerResult LEDControl::onSetup()
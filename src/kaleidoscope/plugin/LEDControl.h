@@ -37,6 +37,8 @@ namespace kaleidoscope
     public:
       LEDControl(void);
 
+      typedef kaleidoscope::key_routing::KeyFlags<SYNTHETIC | IS_INTERNAL | LED_TOGGLE> RoutedKeys;
+
       static void next_mode(void);
       static void prev_mode(void);
       static void setup(void);
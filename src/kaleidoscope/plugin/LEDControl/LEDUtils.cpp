@@ -56,6 +56,100 @@ breath_compute(uint8_t hue, uint8_t saturation, uint8_t phase_offset) {
 //For rgb to hsv, might take a look at:  http://web.mit.edu/storborg/Public/hsvtorgb.c
 
 
+#if KALEIDOSCOPE_HSV_LUT
+
+namespace {
+
+// The order of the fields of cRGB differs between devices, so colors are built
+// by field name.
+cRGB rgb(uint8_t r, uint8_t g, uint8_t b) {
+  cRGB color;
+  color.r = r;
+  color.g = g;
+  color.b = b;
+  return color;
+}
+
+// The fully saturated, full value color of every hue, computed at compile
+// time with the same integer math as the arithmetic `hsvToRgb()` below,
+// written as single expressions so that it builds as C++11. Entries are kept
+// in r, g, b order, whatever the order of the fields of cRGB is on the device.
+struct WheelColor {
+  uint8_t r, g, b;
+};
+
+struct HueWheel {
+  WheelColor colors[256];
+};
+
+// `q` and `t` of the arithmetic version, at full saturation and value.
+constexpr uint8_t wheelFall(uint8_t fpart) {
+  return (255 * (255 - ((255 * fpart) >> 8))) >> 8;
+}
+constexpr uint8_t wheelRise(uint8_t fpart) {
+  return (255 * (255 - ((255 * (255 - fpart)) >> 8))) >> 8;
+}
+
+constexpr WheelColor wheelColor(uint8_t region, uint8_t fpart) {
+  return region == 0 ? WheelColor{255, wheelRise(fpart), 0} :
+         region == 1 ? WheelColor{wheelFall(fpart), 255, 0} :
+         region == 2 ? WheelColor{0, 255, wheelRise(fpart)} :
+         region == 3 ? WheelColor{0, wheelFall(fpart), 255} :
+         region == 4 ? WheelColor{wheelRise(fpart), 0, 255} :
+         WheelColor{255, 0, wheelFall(fpart)};
+}
+
+constexpr WheelColor wheelColor(uint16_t h) {
+  return wheelColor((h * 6) >> 8, (h * 6) & 0xff);
+}
+
+template<uint8_t... hues__>
+struct HueSequence {};
+
+template<uint16_t n__, uint8_t... hues__>
+struct MakeHueSequence : MakeHueSequence < n__ - 1, n__ - 1, hues__... > {};
+
+template<uint8_t... hues__>
+struct MakeHueSequence<0, hues__...> {
+  typedef HueSequence<hues__...> type;
+};
+
+template<uint8_t... hues__>
+constexpr HueWheel makeHueWheel(HueSequence<hues__...>) {
+  return HueWheel {{ wheelColor(hues__)... }};
+}
+
+constexpr HueWheel hue_wheel PROGMEM = makeHueWheel(MakeHueSequence<256>::type());
+
+// Scales a channel of the wheel to the given saturation and value.
+inline uint8_t scaleChannel(uint8_t c, uint8_t s, uint8_t v) {
+  uint8_t x = 255 - ((s * (255 - c)) >> 8);
+  return (v * (x + 1)) >> 8;
+}
+
+}
+
+cRGB
+hsvToRgb(uint16_t h, uint16_t s, uint16_t v) {
+  if (s == 0)
+    return rgb(v, v, v);
+
+  const WheelColor *wheel = &hue_wheel.colors[h & 0xff];
+  cRGB color = rgb(pgm_read_byte(&wheel->r),
+                   pgm_read_byte(&wheel->g),
+                   pgm_read_byte(&wheel->b));
+
+  if (s == 255 && v == 255)
+    return color;
+
+  color.r = scaleChannel(color.r, s, v);
+  color.g = scaleChannel(color.g, s, v);
+  color.b = scaleChannel(color.b, s, v);
+  return color;
+}
+
+#else
+
 // From http://web.mit.edu/storborg/Public/hsvtorgb.c - talk to Scott about licensing
 cRGB
 hsvToRgb(uint16_t h, uint16_t s, uint16_t v) {
@@ -117,3 +211,5 @@ hsvToRgb(uint16_t h, uint16_t s, uint16_t v) {
 
   return color;
 }
+
+#endif
@@ -18,5 +18,17 @@
 
 #include "kaleidoscope/Runtime.h"
 
+// When set, `hsvToRgb()` looks the hue up in a table of fully saturated colors
+// built at compile time, and only scales it to the saturation and value. The
+// table takes 768 bytes of flash, so it is off by default on AVR, where the
+// arithmetic version is used instead.
+#ifndef KALEIDOSCOPE_HSV_LUT
+#ifdef __AVR__
+#define KALEIDOSCOPE_HSV_LUT 0
+#else
+#define KALEIDOSCOPE_HSV_LUT 1
+#endif
+#endif
+
 cRGB breath_compute(uint8_t hue = 170, uint8_t saturation = 255, uint8_t phase_offset = 0);
 cRGB hsvToRgb(uint16_t h, uint16_t s, uint16_t v);
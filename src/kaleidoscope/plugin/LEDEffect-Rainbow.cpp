@@ -61,17 +61,23 @@ void LEDRainbowWaveEffect::TransientLEDMode::update(void) {
     rainbow_last_update += parent_->rainbow_update_delay;
   }
 
+  // Every group of four LEDs shares the same hue, so the color is only
+  // computed once per group.
+  cRGB rainbow = {};
+
   for (auto led_index : Runtime.device().LEDs().all()) {
-    uint16_t led_hue = rainbow_hue + 16 * (led_index.offset() / 4);
-    // We want led_hue to be capped at 255, but we do not want to clip it to
-    // that, because that does not result in a nice animation. Instead, when it
-    // is higher than 255, we simply substract 255, and repeat that until we're
-    // within cap. This lays out the rainbow in a kind of wave.
-    while (led_hue >= 255) {
-      led_hue -= 255;
+    if (led_index.offset() % 4 == 0) {
+      uint16_t led_hue = rainbow_hue + 16 * (led_index.offset() / 4);
+      // We want led_hue to be capped at 255, but we do not want to clip it to
+      // that, because that does not result in a nice animation. Instead, when it
+      // is higher than 255, we simply substract 255, and repeat that until we're
+      // within cap. This lays out the rainbow in a kind of wave.
+      while (led_hue >= 255) {
+        led_hue -= 255;
+      }
+
+      rainbow = hsvToRgb(led_hue, rainbow_saturation, parent_->rainbow_value);
     }
-
-    cRGB rainbow = hsvToRgb(led_hue, rainbow_saturation, parent_->rainbow_value);
     ::LEDControl.setCrgbAt(led_index.offset(), rainbow);
   }
   rainbow_hue += rainbow_wave_steps;
@@ -74,6 +74,15 @@ class LEDMode : public kaleidoscope::Plugin,
    */
   virtual void onActivate(void) {}
 
+  /** Function to call whenever the mode is about to be deactivated.
+   *
+   * Called when switching to another LED mode, before the new one is
+   * activated. For transient LED modes, this is the last chance to act on
+   * their state (to save it to storage, for example): the instance is
+   * destroyed right after this returns.
+   */
+  virtual void onDeactivate(void) {}
+
   /** Update the LEDs once per cycle.
    *
    * Usually the brains of the plugin, which updates the LEDs each cycle. It is
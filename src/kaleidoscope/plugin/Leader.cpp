@@ -29,6 +29,11 @@ uint8_t Leader::sequence_pos_;
 uint16_t Leader::start_time_ = 0;
 uint16_t Leader::time_out = 1000;
 const Leader::dictionary_t *Leader::dictionary;
+const Leader::dictionary_t *Leader::checked_dictionary_;
+uint8_t Leader::dictionary_size_;
+bool Leader::dictionary_sorted_;
+uint8_t Leader::match_begin_;
+uint8_t Leader::match_end_;
 
 // --- helpers ---
 
@@ -39,15 +44,96 @@ const Leader::dictionary_t *Leader::dictionary;
 #define isActive() (sequence_[0] != Key_NoKey)
 
 // --- actions ---
-int8_t Leader::lookup(void) {
+
+// The dictionary can be replaced at any time, so we check it whenever a new
+// sequence starts. If the entries are sorted by their keys, every entry that
+// matches the sequence so far is in a contiguous range, and each new key only
+// needs a binary search within that range. If they are not, we fall back to
+// scanning the whole dictionary on every key.
+void Leader::checkDictionary(void) {
+  if (dictionary == checked_dictionary_)
+    return;
+
+  checked_dictionary_ = dictionary;
+  dictionary_size_ = 0;
+  dictionary_sorted_ = true;
+
+  if (dictionary == nullptr)
+    return;
+
+  Key prev[LEADER_MAX_SEQUENCE_LENGTH + 1];
+  for (uint8_t i = 0; i <= LEADER_MAX_SEQUENCE_LENGTH; i++)
+    prev[i] = Key_NoKey;
+
+  while (dictionary[dictionary_size_].sequence[0].readFromProgmem() != Key_NoKey) {
+    if (dictionary_size_ == 255) {
+      dictionary_sorted_ = false;
+      return;
+    }
+
+    for (uint8_t i = 0; i <= LEADER_MAX_SEQUENCE_LENGTH; i++) {
+      Key key = dictionary[dictionary_size_].sequence[i].readFromProgmem();
+      if (key.getRaw() < prev[i].getRaw()) {
+        dictionary_sorted_ = false;
+        break;
+      }
+      if (key != prev[i])
+        break;
+    }
+    for (uint8_t i = 0; i <= LEADER_MAX_SEQUENCE_LENGTH; i++)
+      prev[i] = dictionary[dictionary_size_].sequence[i].readFromProgmem();
+
+    dictionary_size_++;
+  }
+}
+
+void Leader::narrowMatches(void) {
+  if (!dictionary_sorted_)
+    return;
+
+  uint16_t raw = sequence_[sequence_pos_].getRaw();
+  uint8_t lo = match_begin_, hi = match_end_;
+
+  // Find the first entry with a key >= raw at the current position...
+  while (lo < hi) {
+    uint8_t mid = lo + (hi - lo) / 2;
+    if (dictionary[mid].sequence[sequence_pos_].readFromProgmem().getRaw() < raw)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  match_begin_ = lo;
+
+  // ...and the first one past it with a key > raw.
+  hi = match_end_;
+  while (lo < hi) {
+    uint8_t mid = lo + (hi - lo) / 2;
+    if (dictionary[mid].sequence[sequence_pos_].readFromProgmem().getRaw() <= raw)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  match_end_ = lo;
+}
+
+int16_t Leader::lookup(void) {
+  if (dictionary_sorted_) {
+    if (match_begin_ == match_end_)
+      return NO_MATCH;
+
+    // The shortest match sorts first, so if any entry matches the sequence
+    // exactly, it is the first one in the range.
+    Key seq_key = dictionary[match_begin_].sequence[sequence_pos_ + 1].readFromProgmem();
+    if (seq_key == Key_NoKey)
+      return match_begin_;
+    return PARTIAL_MATCH;
+  }
+
   bool match;
 
-  for (uint8_t seq_index = 0; ; seq_index++) {
+  for (uint8_t seq_index = 0; seq_index < dictionary_size_; seq_index++) {
     match = true;
 
-    if (dictionary[seq_index].sequence[0].readFromProgmem() == Key_NoKey)
-      break;
-
     Key seq_key;
     for (uint8_t i = 0; i <= sequence_pos_; i++) {
       seq_key = dictionary[seq_index].sequence[i].readFromProgmem();
@@ -100,6 +186,11 @@ EventHandlerResult Leader::onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, u
       start_time_ = Runtime.millisAtCycleStart();
       sequence_pos_ = 0;
       sequence_[sequence_pos_] = mapped_key;
+
+      checkDictionary();
+      match_begin_ = 0;
+      match_end_ = dictionary_size_;
+      narrowMatches();
     }
 
     // If the sequence was not active yet, ignore the key.
@@ -107,7 +198,7 @@ EventHandlerResult Leader::onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, u
   }
 
   // active
-  int8_t action_index = lookup();
+  int16_t action_index = lookup();
 
   if (keyToggledOn(keyState)) {
     sequence_pos_++;
@@ -118,6 +209,7 @@ EventHandlerResult Leader::onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, u
 
     start_time_ = Runtime.millisAtCycleStart();
     sequence_[sequence_pos_] = mapped_key;
+    narrowMatches();
     action_index = lookup();
 
     if (action_index >= 0) {
@@ -41,11 +41,22 @@ class Leader : public kaleidoscope::Plugin {
   Leader(void) {}
   static const dictionary_t *dictionary;
 
+  // Returns true if the dictionary (including its terminating entry) is sorted
+  // the way `Leader` needs it to be to use a binary search instead of a linear
+  // scan. Meant to be used in a `static_assert()`, with a `constexpr`
+  // dictionary.
+  template <uint8_t _size>
+  static constexpr bool isSorted(const dictionary_t (&dict)[_size]) {
+    return isSortedFrom(dict, _size - 1, 1);
+  }
+
   static void reset(void);
   static uint16_t time_out;
 
   void inject(Key key, uint8_t key_state);
 
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t keyState);
   EventHandlerResult afterEachCycle();
 
@@ -54,7 +65,27 @@ class Leader : public kaleidoscope::Plugin {
   static uint8_t sequence_pos_;
   static uint16_t start_time_;
 
-  static int8_t lookup(void);
+  static const dictionary_t *checked_dictionary_;
+  static uint8_t dictionary_size_;
+  static bool dictionary_sorted_;
+  static uint8_t match_begin_;
+  static uint8_t match_end_;
+
+  static void checkDictionary(void);
+  static void narrowMatches(void);
+  static int16_t lookup(void);
+
+  static constexpr bool isOrdered(const dictionary_t &a, const dictionary_t &b,
+                                  uint8_t pos = 0) {
+    return pos > LEADER_MAX_SEQUENCE_LENGTH ||
+           a.sequence[pos].getRaw() < b.sequence[pos].getRaw() ||
+           (a.sequence[pos] == b.sequence[pos] && isOrdered(a, b, pos + 1));
+  }
+  static constexpr bool isSortedFrom(const dictionary_t *dict, uint8_t size,
+                                     uint8_t i) {
+    return i >= size ||
+           (isOrdered(dict[i - 1], dict[i]) && isSortedFrom(dict, size, i + 1));
+  }
 };
 }
 
@@ -17,6 +17,7 @@
 #include "Kaleidoscope-Macros.h"
 #include "kaleidoscope/keyswitch_state.h"
 #include "kaleidoscope/key_events.h"
+#include "kaleidoscope/plugin/MouseKeys/MouseKeyDefs.h"
 
 __attribute__((weak))
 const macro_t *macroAction(uint8_t macroIndex, uint8_t keyState) {
@@ -30,111 +31,275 @@ MacroKeyEvent Macros_::active_macros[];
 byte Macros_::active_macro_count;
 KeyAddr Macros_::key_addr;
 
-void playMacroKeyswitchEvent(Key key, uint8_t keyswitch_state, bool explicit_report) {
-  handleKeyswitchEvent(key, UnknownKeyswitchLocation, keyswitch_state | INJECTED);
-
-  if (explicit_report)
+Macros_::QueueEntry Macros_::queue_[];
+uint8_t Macros_::queue_head_;
+uint8_t Macros_::queue_length_;
+const macro_t *Macros_::cursor_;
+bool Macros_::cursor_is_string_;
+uint8_t Macros_::sequence_;
+uint8_t Macros_::interval_;
+bool Macros_::explicit_report_;
+Key Macros_::tap_key_;
+uint16_t Macros_::pause_start_;
+uint16_t Macros_::pause_time_;
+bool Macros_::synchronous_;
+bool Macros_::held_keys_pressed_;
+Key Macros_::held_keys_[];
+uint8_t Macros_::held_key_count_;
+bool Macros_::mouse_report_pending_;
+
+// --- queue ---
+
+void Macros_::enqueue(const macro_t *data, bool is_string) {
+  if (!data)
     return;
 
-  kaleidoscope::Runtime.hid().keyboard().sendReport();
-  kaleidoscope::Runtime.hid().mouse().sendReport();
+  // If there's no room left, play everything that's queued right away, and
+  // start with an empty queue.
+  if (queue_length_ == MAX_QUEUED_MACROS)
+    flush();
+
+  uint8_t tail = (queue_head_ + queue_length_) % MAX_QUEUED_MACROS;
+  queue_[tail].data = data;
+  queue_[tail].is_string = is_string;
+  queue_length_++;
+}
+
+bool Macros_::startNext() {
+  if (queue_length_ == 0)
+    return false;
+
+  cursor_ = queue_[queue_head_].data;
+  cursor_is_string_ = queue_[queue_head_].is_string;
+  queue_head_ = (queue_head_ + 1) % MAX_QUEUED_MACROS;
+  queue_length_--;
+
+  sequence_ = MACRO_ACTION_END;
+  interval_ = 0;
+  explicit_report_ = false;
+  return true;
 }
 
-static void playKeyCode(Key key, uint8_t keyStates, bool explicit_report) {
-  if (keyIsPressed(keyStates)) {
-    playMacroKeyswitchEvent(key, IS_PRESSED, explicit_report);
+void Macros_::endCurrent() {
+  cursor_ = nullptr;
+  // Keys a macro leaves pressed are released on the next cycle, as they
+  // always were: they're just not pressed again.
+  held_key_count_ = 0;
+}
+
+// --- playback ---
+
+void Macros_::holdKey(Key key) {
+  for (uint8_t i = 0; i < held_key_count_; i++) {
+    if (held_keys_[i] == key)
+      return;
   }
-  if (keyWasPressed(keyStates)) {
-    playMacroKeyswitchEvent(key, WAS_PRESSED, explicit_report);
+  if (held_key_count_ < MAX_MACRO_HELD_KEYS)
+    held_keys_[held_key_count_++] = key;
+}
+
+void Macros_::releaseHeldKey(Key key) {
+  for (uint8_t i = 0; i < held_key_count_; i++) {
+    if (held_keys_[i] == key) {
+      held_keys_[i] = held_keys_[--held_key_count_];
+      return;
+    }
   }
 }
 
-static void readKeyCodeAndPlay(const macro_t *macro_p, uint8_t flags, uint8_t keyStates, bool explicit_report) {
-  Key key(pgm_read_byte(macro_p++), // key_code
-          flags);
+// Held keys are pressed again on every cycle, like physical keys are, because
+// the report is cleared at the end of each cycle. This is done lazily, so that
+// if the macro ends without playing anything else, they're not.
+void Macros_::pressHeldKeys() {
+  if (synchronous_ || held_keys_pressed_)
+    return;
 
-  playKeyCode(key, keyStates, explicit_report);
+  held_keys_pressed_ = true;
+  for (uint8_t i = 0; i < held_key_count_; i++)
+    handleKeyswitchEvent(held_keys_[i], UnknownKeyswitchLocation,
+                         IS_PRESSED | WAS_PRESSED | INJECTED);
 }
 
-void Macros_::play(const macro_t *macro_p) {
-  macro_t macro = MACRO_ACTION_END;
-  uint8_t interval = 0;
-  uint8_t flags;
-  bool explicit_report = false;
+void Macros_::playEvent(Key key, uint8_t key_state) {
+  pressHeldKeys();
+  handleKeyswitchEvent(key, UnknownKeyswitchLocation, key_state | INJECTED);
+
+  // When playing synchronously, we send the reports ourselves, and only send
+  // the mouse report if a mouse key was played. Otherwise, the mouse report is
+  // sent by MouseKeys at the end of the cycle.
+  if (synchronous_ &&
+      (key.getFlags() & (SYNTHETIC | IS_MOUSE_KEY)) == (SYNTHETIC | IS_MOUSE_KEY))
+    mouse_report_pending_ = true;
+}
+
+void Macros_::tap(Key key) {
+  playEvent(key, IS_PRESSED);
+  tap_key_ = key;
+}
 
-  if (!macro_p)
+void Macros_::pause(uint16_t time) {
+  if (time == 0)
     return;
 
-  while (true) {
-    switch (macro = pgm_read_byte(macro_p++)) {
+  if (synchronous_) {
+    delay(time);
+    return;
+  }
+
+  pause_start_ = Runtime.millisAtCycleStart();
+  pause_time_ = time;
+}
+
+// Plays the events that make up the next report: every step up to (and
+// including) the first one that needs a report of its own, or a pause. Returns
+// false if there was nothing left to play.
+bool Macros_::playFrame() {
+  bool played = false;
+  uint8_t flags;
+
+  held_keys_pressed_ = false;
+
+  if (pause_time_ != 0) {
+    if (!Runtime.hasTimeExpired(pause_start_, pause_time_)) {
+      pressHeldKeys();
+      return true;
+    }
+    pause_time_ = 0;
+  }
+
+  // The second half of a tap.
+  if (tap_key_ != Key_NoKey) {
+    playEvent(tap_key_, WAS_PRESSED);
+    tap_key_ = Key_NoKey;
+    pause(interval_);
+    return true;
+  }
+
+  while (cursor_ || startNext()) {
+    if (cursor_is_string_) {
+      uint8_t ascii_code = pgm_read_byte(cursor_++);
+      if (!ascii_code) {
+        endCurrent();
+        continue;
+      }
+
+      Key key = lookupAsciiCode(ascii_code);
+      if (key == Key_NoKey)
+        continue;
+
+      tap(key);
+      return true;
+    }
+
+    if (sequence_ != MACRO_ACTION_END) {
+      flags = 0;
+      if (sequence_ == MACRO_ACTION_STEP_TAP_SEQUENCE)
+        flags = pgm_read_byte(cursor_++);
+      uint8_t key_code = pgm_read_byte(cursor_++);
+
+      if (flags == 0 && key_code == 0) {
+        sequence_ = MACRO_ACTION_END;
+        continue;
+      }
+
+      tap(Key(key_code, flags));
+      return true;
+    }
+
+    uint8_t step = pgm_read_byte(cursor_++);
+    switch (step) {
     case MACRO_ACTION_STEP_EXPLICIT_REPORT:
-      explicit_report = true;
+      explicit_report_ = true;
       break;
     case MACRO_ACTION_STEP_IMPLICIT_REPORT:
-      explicit_report = false;
+      explicit_report_ = false;
       break;
     case MACRO_ACTION_STEP_SEND_REPORT:
-      kaleidoscope::Runtime.hid().keyboard().sendReport();
-      kaleidoscope::Runtime.hid().mouse().sendReport();
-      break;
+      pressHeldKeys();
+      pause(interval_);
+      return true;
     case MACRO_ACTION_STEP_INTERVAL:
-      interval = pgm_read_byte(macro_p++);
+      interval_ = pgm_read_byte(cursor_++);
       break;
-    case MACRO_ACTION_STEP_WAIT: {
-      uint8_t wait = pgm_read_byte(macro_p++);
-      delay(wait);
+    case MACRO_ACTION_STEP_WAIT:
+      pause(pgm_read_byte(cursor_++));
+      if (played || pause_time_ != 0) {
+        pressHeldKeys();
+        return true;
+      }
       break;
-    }
+
     case MACRO_ACTION_STEP_KEYDOWN:
-      flags = pgm_read_byte(macro_p++);
-      readKeyCodeAndPlay(macro_p++, flags, IS_PRESSED, explicit_report);
-      break;
     case MACRO_ACTION_STEP_KEYUP:
-      flags = pgm_read_byte(macro_p++);
-      readKeyCodeAndPlay(macro_p++, flags, WAS_PRESSED, explicit_report);
-      break;
-    case MACRO_ACTION_STEP_TAP:
-      flags = pgm_read_byte(macro_p++);
-      readKeyCodeAndPlay(macro_p++, flags, IS_PRESSED | WAS_PRESSED, false);
-      break;
-
     case MACRO_ACTION_STEP_KEYCODEDOWN:
-      readKeyCodeAndPlay(macro_p++, 0, IS_PRESSED, explicit_report);
-      break;
-    case MACRO_ACTION_STEP_KEYCODEUP:
-      readKeyCodeAndPlay(macro_p++, 0, WAS_PRESSED, explicit_report);
+    case MACRO_ACTION_STEP_KEYCODEUP: {
+      flags = 0;
+      if (step == MACRO_ACTION_STEP_KEYDOWN || step == MACRO_ACTION_STEP_KEYUP)
+        flags = pgm_read_byte(cursor_++);
+      Key key(pgm_read_byte(cursor_++), flags);
+
+      if (step == MACRO_ACTION_STEP_KEYDOWN || step == MACRO_ACTION_STEP_KEYCODEDOWN) {
+        playEvent(key, IS_PRESSED);
+        holdKey(key);
+      } else {
+        playEvent(key, WAS_PRESSED);
+        releaseHeldKey(key);
+      }
+      played = true;
+
+      if (!explicit_report_) {
+        pause(interval_);
+        return true;
+      }
       break;
+    }
+    case MACRO_ACTION_STEP_TAP:
+      flags = pgm_read_byte(cursor_++);
+      tap(Key(pgm_read_byte(cursor_++), flags));
+      return true;
     case MACRO_ACTION_STEP_TAPCODE:
-      readKeyCodeAndPlay(macro_p++, 0, IS_PRESSED | WAS_PRESSED, false);
-      break;
+      tap(Key(pgm_read_byte(cursor_++), 0));
+      return true;
 
-    case MACRO_ACTION_STEP_TAP_SEQUENCE: {
-      uint8_t keyCode;
-      do {
-        flags = pgm_read_byte(macro_p++);
-        keyCode = pgm_read_byte(macro_p++);
-        playKeyCode(Key(keyCode, flags), IS_PRESSED | WAS_PRESSED, false);
-        delay(interval);
-      } while (!(flags == 0 && keyCode == 0));
-      break;
-    }
-    case MACRO_ACTION_STEP_TAP_CODE_SEQUENCE: {
-      uint8_t keyCode;
-      do {
-        keyCode = pgm_read_byte(macro_p++);
-        playKeyCode(Key(keyCode, 0), IS_PRESSED | WAS_PRESSED, false);
-        delay(interval);
-      } while (keyCode != 0);
+    case MACRO_ACTION_STEP_TAP_SEQUENCE:
+    case MACRO_ACTION_STEP_TAP_CODE_SEQUENCE:
+      sequence_ = step;
       break;
-    }
 
     case MACRO_ACTION_END:
     default:
-      return;
+      endCurrent();
+      // Don't let the next macro's keys end up in the same report.
+      if (played)
+        return true;
+      break;
     }
+  }
 
-    delay(interval);
+  return false;
+}
+
+void Macros_::flush() {
+  // Whatever the current macro is holding may not be in the report yet.
+  held_keys_pressed_ = false;
+  pressHeldKeys();
+
+  synchronous_ = true;
+  pause_time_ = 0;
+
+  while (playFrame()) {
+    kaleidoscope::Runtime.hid().keyboard().sendReport();
+    if (mouse_report_pending_) {
+      kaleidoscope::Runtime.hid().mouse().sendReport();
+      mouse_report_pending_ = false;
+    }
   }
+
+  synchronous_ = false;
+}
+
+void Macros_::play(const macro_t *macro_p) {
+  enqueue(macro_p, false);
 }
 
 static const Key ascii_to_key_map[] PROGMEM = {
@@ -224,21 +389,7 @@ Key Macros_::lookupAsciiCode(uint8_t ascii_code) {
 }
 
 const macro_t *Macros_::type(const char *string) {
-  while (true) {
-    uint8_t ascii_code = pgm_read_byte(string++);
-    if (!ascii_code)
-      break;
-
-    Key key = lookupAsciiCode(ascii_code);
-
-
-    if (key == Key_NoKey)
-      continue;
-
-    playMacroKeyswitchEvent(key, IS_PRESSED, false);
-    playMacroKeyswitchEvent(key, WAS_PRESSED, false);
-
-  }
+  enqueue(reinterpret_cast<const macro_t *>(string), true);
 
   return MACRO_NONE;
 }
@@ -276,6 +427,10 @@ EventHandlerResult Macros_::beforeReportingState() {
                                    active_macros[i].key_state);
     Macros.play(m);
   }
+
+  if (busy())
+    playFrame();
+
   return EventHandlerResult::OK;
 }
 
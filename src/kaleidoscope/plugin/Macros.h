@@ -29,6 +29,14 @@ const macro_t *macroAction(uint8_t macroIndex, uint8_t keyState);
 #define MAX_CONCURRENT_MACROS 8
 #endif
 
+#if !defined(MAX_QUEUED_MACROS)
+#define MAX_QUEUED_MACROS 8
+#endif
+
+#if !defined(MAX_MACRO_HELD_KEYS)
+#define MAX_MACRO_HELD_KEYS 8
+#endif
+
 struct MacroKeyEvent {
   byte key_code;
   byte key_id;
@@ -42,6 +50,11 @@ class Macros_ : public kaleidoscope::Plugin {
  public:
   Macros_(void) {}
 
+  typedef kaleidoscope::key_routing::KeyRange<ranges::MACRO_FIRST,
+                                              ranges::MACRO_LAST> RoutedKeys;
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+  typedef RoutedKeys HeldKeys;
+
   static MacroKeyEvent active_macros[MAX_CONCURRENT_MACROS];
   static byte active_macro_count;
   static void addActiveMacroKey(byte key_code, byte key_id, byte key_state) {
@@ -61,6 +74,14 @@ class Macros_ : public kaleidoscope::Plugin {
 
   void play(const macro_t *macro_p);
 
+  // Macros and strings are queued, and played back one report per cycle from
+  // `beforeReportingState()`. These let one check if there's anything left to
+  // play, and play everything queued right away, the old-fashioned way.
+  static bool busy() {
+    return cursor_ != nullptr || queue_length_ != 0;
+  }
+  static void flush();
+
   /* What follows below, is a bit of template magic that allows us to use
      Macros.type() with any number of arguments, without having to use a
      sentinel. See the comments on Runtime.use() for more details - this is
@@ -79,7 +100,46 @@ class Macros_ : public kaleidoscope::Plugin {
   static KeyAddr key_addr;
 
  private:
-  Key lookupAsciiCode(uint8_t ascii_code);
+  struct QueueEntry {
+    const macro_t *data;
+    bool is_string;
+  };
+
+  static QueueEntry queue_[MAX_QUEUED_MACROS];
+  static uint8_t queue_head_;
+  static uint8_t queue_length_;
+
+  // The state of the macro or string being played.
+  static const macro_t *cursor_;
+  static bool cursor_is_string_;
+  static uint8_t sequence_;
+  static uint8_t interval_;
+  static bool explicit_report_;
+  static Key tap_key_;
+  static uint16_t pause_start_;
+  static uint16_t pause_time_;
+  static bool synchronous_;
+  static bool held_keys_pressed_;
+
+  // Keys pressed by the macro being played, and not released yet. These are
+  // pressed again on every cycle, like physically held keys are.
+  static Key held_keys_[MAX_MACRO_HELD_KEYS];
+  static uint8_t held_key_count_;
+
+  static bool mouse_report_pending_;
+
+  static void enqueue(const macro_t *data, bool is_string);
+  static bool startNext();
+  static void endCurrent();
+  static bool playFrame();
+  static void playEvent(Key key, uint8_t key_state);
+  static void tap(Key key);
+  static void pause(uint16_t time);
+  static void pressHeldKeys();
+  static void holdKey(Key key);
+  static void releaseHeldKey(Key key);
+
+  static Key lookupAsciiCode(uint8_t ascii_code);
   bool isMacroKey(Key key);
 };
 
@@ -16,38 +16,79 @@
  */
 
 #include <Kaleidoscope-MagicCombo.h>
+#include "kaleidoscope/keyswitch_state.h"
 
 namespace kaleidoscope {
 namespace plugin {
 
 uint16_t MagicCombo::min_interval = 500;
 uint16_t MagicCombo::start_time_ = 0;
+uint8_t MagicCombo::pressed_[MagicCombo::mask_bytes];
+uint8_t MagicCombo::pressed_count_ = 0;
+bool MagicCombo::matrix_changed_ = false;
+int8_t MagicCombo::matched_combo_ = -1;
 
-EventHandlerResult MagicCombo::beforeReportingState() {
-  for (byte i = 0; i < magiccombo::combos_length; i++) {
-    bool match = true;
-    byte j;
+EventHandlerResult MagicCombo::onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
+  // Key events only tell us when to look at the matrix again. The held keys
+  // themselves are read from the scanner, so that plugins consuming or
+  // delaying events before us do not throw the match off.
+  if (key_addr.isValid() && (keyToggledOn(key_state) || keyToggledOff(key_state)))
+    matrix_changed_ = true;
 
-    for (j = 0; j < MAX_COMBO_LENGTH; j++) {
-      int8_t comboKey = pgm_read_byte(&(magiccombo::combos[i].keys[j]));
+  return EventHandlerResult::OK;
+}
 
-      if (comboKey == 0)
-        break;
+void MagicCombo::readMatrix() {
+  memset(pressed_, 0, sizeof(pressed_));
 
-      match &= Runtime.device().isKeyswitchPressed(comboKey);
-      if (!match)
-        break;
+  for (auto key_addr : KeyAddr::all()) {
+    if (Runtime.device().isKeyswitchPressed(key_addr)) {
+      uint8_t bit = key_addr.toInt();
+      pressed_[bit / 8] |= 1 << (bit % 8);
     }
+  }
+}
 
-    if (j != Runtime.device().pressedKeyswitchCount())
-      match = false;
+int8_t MagicCombo::findCombo() {
+  uint8_t held = 0;
+  for (uint8_t b = 0; b < mask_bytes; b++)
+    held |= pressed_[b];
 
-    if (match && Runtime.hasTimeExpired(start_time_, min_interval)) {
-      ComboAction action = (ComboAction) pgm_read_ptr((void const **) & (magiccombo::combos[i].action));
+  // An empty mask would otherwise match whenever no key is held.
+  if (!held)
+    return -1;
 
-      (*action)(i);
-      start_time_ = Runtime.millisAtCycleStart();
+  for (uint8_t i = 0; i < magiccombo::combos_length; i++) {
+    uint8_t b = 0;
+
+    for (; b < mask_bytes; b++) {
+      if (pgm_read_byte(&(magiccombo::masks[i].bits[b])) != pressed_[b])
+        break;
     }
+
+    if (b == mask_bytes)
+      return i;
+  }
+
+  return -1;
+}
+
+EventHandlerResult MagicCombo::beforeReportingState() {
+  // Should an earlier plugin have swallowed the key event, a change in the
+  // number of held keys still gives it away.
+  uint8_t pressed_count = Runtime.device().pressedKeyswitchCount();
+  if (matrix_changed_ || pressed_count != pressed_count_) {
+    readMatrix();
+    matched_combo_ = findCombo();
+    pressed_count_ = pressed_count;
+    matrix_changed_ = false;
+  }
+
+  if (matched_combo_ >= 0 && Runtime.hasTimeExpired(start_time_, min_interval)) {
+    ComboAction action = (ComboAction) pgm_read_ptr((void const **) & (magiccombo::combos[matched_combo_].action));
+
+    (*action)(matched_combo_);
+    start_time_ = Runtime.millisAtCycleStart();
   }
 
   return EventHandlerResult::OK;
@@ -25,10 +25,15 @@
   namespace kaleidoscope {                                                \
   namespace plugin {                                                      \
   namespace magiccombo {                                                  \
-  const kaleidoscope::plugin::MagicCombo::Combo combos[] PROGMEM =        \
+  constexpr kaleidoscope::plugin::MagicCombo::Combo combos[] PROGMEM =    \
     {__VA_ARGS__};                                                        \
                                                                           \
   const uint8_t combos_length = sizeof(combos) / sizeof(*combos);         \
+                                                                          \
+  constexpr internal::ComboMasks<sizeof(combos) / sizeof(*combos)>        \
+    compiled_masks PROGMEM = internal::compileMasks(combos);              \
+  const kaleidoscope::plugin::MagicCombo::ComboMask *const masks =        \
+    compiled_masks.masks;                                                 \
   }                                                                       \
   }                                                                       \
   }
@@ -44,19 +49,92 @@ class MagicCombo : public kaleidoscope::Plugin {
     int8_t keys[MAX_COMBO_LENGTH + 1];
   } Combo;
 
+  // One bit per key, indexed by `KeyAddr::toInt()`, so the bits follow the
+  // row-major order of the scanner's matrix state.
+  static constexpr uint8_t mask_bytes = (KeyAddr::upper_limit + 7) / 8;
+  typedef struct {
+    uint8_t bits[mask_bytes];
+  } ComboMask;
+
   MagicCombo(void) {}
 
   static uint16_t min_interval;
 
+  EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state);
   EventHandlerResult beforeReportingState();
 
  private:
   static uint16_t start_time_;
+  static uint8_t pressed_[mask_bytes];
+  static uint8_t pressed_count_;
+  static bool matrix_changed_;
+  static int8_t matched_combo_;
+
+  static void readMatrix();
+  static int8_t findCombo();
 };
 
 namespace magiccombo {
 extern const MagicCombo::Combo combos[];
 extern const uint8_t combos_length;
+extern const MagicCombo::ComboMask *const masks;
+
+namespace internal {
+
+// The masks are compiled from `combos[]` by the `USE_MAGIC_COMBOS()` macro, so
+// that matching a combo at runtime is a plain comparison against the bitmap of
+// pressed keys, and nothing needs to be built in RAM.
+
+template<uint8_t... indices__>
+struct ComboSequence {};
+
+template<uint8_t n__, uint8_t... indices__>
+struct MakeComboSequence : MakeComboSequence < n__ - 1, n__ - 1, indices__... > {};
+
+template<uint8_t... indices__>
+struct MakeComboSequence<0, indices__...> {
+  typedef ComboSequence<indices__...> type;
+};
+
+template<uint8_t n__>
+struct ComboMasks {
+  MagicCombo::ComboMask masks[n__];
+};
+
+// The bits of byte `byte__` of the mask, for the keys of `combo` from the
+// `i__`-th on. Combo keys are key indexes, which start at one.
+constexpr uint8_t compileMaskByte(const MagicCombo::Combo &combo,
+                                  uint8_t byte__, uint8_t i__ = 0) {
+  return (i__ >= MAX_COMBO_LENGTH || combo.keys[i__] == 0)
+         ? 0
+         : (((static_cast<uint8_t>(combo.keys[i__]) - 1) / 8 == byte__
+             ? 1 << ((static_cast<uint8_t>(combo.keys[i__]) - 1) % 8)
+             : 0) |
+            compileMaskByte(combo, byte__, i__ + 1));
+}
+
+template<uint8_t... bytes__>
+constexpr MagicCombo::ComboMask compileMask(const MagicCombo::Combo &combo,
+                                            ComboSequence<bytes__...>) {
+  return MagicCombo::ComboMask {{ compileMaskByte(combo, bytes__)... }};
+}
+
+constexpr MagicCombo::ComboMask compileMask(const MagicCombo::Combo &combo) {
+  return compileMask(combo, MakeComboSequence<MagicCombo::mask_bytes>::type());
+}
+
+template<uint8_t n__, uint8_t... indices__>
+constexpr ComboMasks<n__> compileMasks(const MagicCombo::Combo(&combos)[n__],
+                                       ComboSequence<indices__...>) {
+  return ComboMasks<n__> {{ compileMask(combos[indices__])... }};
+}
+
+template<uint8_t n__>
+constexpr ComboMasks<n__> compileMasks(const MagicCombo::Combo(&combos)[n__]) {
+  return compileMasks(combos, typename MakeComboSequence<n__>::type());
+}
+
+}
 }
 
 }
@@ -28,6 +28,9 @@ class MouseKeys_ : public kaleidoscope::Plugin {
  public:
   MouseKeys_(void) {}
 
+  typedef kaleidoscope::key_routing::KeyFlags<SYNTHETIC | IS_MOUSE_KEY> RoutedKeys;
+  typedef RoutedKeys HeldKeys;
+
   static uint8_t speed;
   static uint16_t speedDelay;
   static uint8_t accelSpeed;
@@ -28,6 +28,12 @@ namespace plugin {
 
 class OneShot : public kaleidoscope::Plugin {
  public:
+  typedef kaleidoscope::key_routing::AnyOf <
+  kaleidoscope::key_routing::KeyRange<Key_LeftControl.getRaw(), Key_RightGui.getRaw()>,
+  kaleidoscope::key_routing::KeyFlags<KEY_FLAGS | SYNTHETIC | SWITCH_TO_KEYMAP>
+  > ProducedKeys;
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   OneShot(void) {
     for (uint8_t i = 0; i < ONESHOT_KEY_COUNT; i++) {
       state_[i].stickable = true;
@@ -64,6 +64,8 @@ EventHandlerResult Qukeys::onKeyswitchEvent(Key& key, KeyAddr k, uint8_t key_sta
     }
     // If we can't trivially ignore the event, just add it to the queue.
     event_queue_.append(k, key_state);
+    if (event_queue_.length() > max_queue_length_)
+      max_queue_length_ = event_queue_.length();
     // In order to prevent overflowing the queue, process it now.
     if (event_queue_.isFull()) {
       processQueue();
@@ -283,6 +285,7 @@ bool Qukeys::processQueue() {
   // queue fills up. We could get multiple events in the same cycle, so this is
   // necessary to avoid reading and writing past the end of the array.
   if (event_queue_.isFull()) {
+    ++queue_overflows_;
     flushEvent(queue_head_.primary_key);
     return true;
   }
@@ -443,7 +446,7 @@ bool isModifierKey(Key key) {
 
 EventHandlerResult Qukeys::onFocusEvent(const char *command)
 {
-  if (::Focus.handleHelp(command, PSTR("qukeys.holdTimeout\nqukeys.overlapThreshold\nqukeys.minimumHoldTime\nqukeys.minimumPriorInterval")))
+  if (::Focus.handleHelp(command, PSTR("qukeys.holdTimeout\nqukeys.overlapThreshold\nqukeys.minimumHoldTime\nqukeys.minimumPriorInterval\nqukeys.queueStats")))
     return EventHandlerResult::OK;
 
   if (strncmp_P(command, PSTR("qukeys."), 7) != 0)
@@ -525,6 +528,18 @@ EventHandlerResult Qukeys::onFocusEvent(const char *command)
     }
   }
 
+  if (strcmp_P(command + 7, PSTR("queueStats")) == 0)
+  {
+    if (::Focus.isEOL())
+    {
+      ::Focus.send(queue_capacity_, max_queue_length_, queue_overflows_);
+    }
+    else
+    {
+      resetQueueStats();
+    }
+  }
+
   return EventHandlerResult::EVENT_CONSUMED;
 }
 
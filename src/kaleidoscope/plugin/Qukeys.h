@@ -34,6 +34,15 @@
 #define ALT_T(key) MT(LeftAlt, key)
 #define GUI_T(key) MT(LeftGui, key)
 
+// The number of press and release events Qukeys can hold while it waits to
+// decide what a qukey does. When it is full, the head of the queue is flushed
+// early, so fast typists rolling over many keys may want a bigger one; each
+// event takes a little over three bytes of RAM. It has to be defined for the
+// whole build (see the documentation), not just in the sketch.
+#ifndef QUKEYS_QUEUE_CAPACITY
+#define QUKEYS_QUEUE_CAPACITY 8
+#endif
+
 #define LT(layer, key) Key(kaleidoscope::ranges::DUL_FIRST + (layer << 8) + (Key_ ## key).getKeyCode())
 
 #define _DEPRECATED_MESSAGE_QUKEY_ROW_COL_CONSTRUCTOR                           \
@@ -88,6 +97,9 @@ struct Qukey {
 class Qukeys : public kaleidoscope::Plugin {
 
  public:
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   // Methods for turning the plugin on and off.
   void activate() {
     active_ = true;
@@ -161,6 +173,20 @@ class Qukeys : public kaleidoscope::Plugin {
     }
   }
 
+  // The number of times a full event queue forced Qukeys to flush its head
+  // early, and the longest the queue has been, since startup or the last call
+  // to `resetQueueStats()`.
+  uint16_t queueOverflows() const {
+    return queue_overflows_;
+  }
+  uint8_t maxQueueLength() const {
+    return max_queue_length_;
+  }
+  void resetQueueStats() {
+    queue_overflows_ = 0;
+    max_queue_length_ = 0;
+  }
+
   // A wildcard value for a qukey that exists on every layer.
   static constexpr int8_t layer_wildcard{-1};
 
@@ -183,11 +209,15 @@ class Qukeys : public kaleidoscope::Plugin {
   uint8_t qukeys_count_{0};
 
   // The maximum number of events in the queue at a time.
-  static constexpr uint8_t queue_capacity_{8};
+  static constexpr uint8_t queue_capacity_{QUKEYS_QUEUE_CAPACITY};
 
   // The event queue stores a series of press and release events.
   KeyAddrEventQueue<queue_capacity_> event_queue_;
 
+  // Statistics of the event queue, see `queueOverflows()`.
+  uint16_t queue_overflows_{0};
+  uint8_t max_queue_length_{0};
+
   // This determines whether the plugin is on or off.
   bool active_{true};
 
@@ -32,23 +32,31 @@ namespace plugin {
 // (press or release). It is optimized for random access to the queue entries,
 // so that each property of each entry can be retrieved without fetching any
 // other data, in order to best serve the specific needs of the Qukeys
-// plugin. Its performance is better for a queue that needs to be searched much
-// more frequently than entries are added or removed.
+// plugin. The entries are kept in a ring buffer, so appending and removing an
+// event take the same time however long the queue is.
 template <uint8_t _capacity,
-          typename _Bitfield  = uint8_t,
           typename _Timestamp = uint16_t>
 class KeyAddrEventQueue {
 
-  static_assert(_capacity <= (sizeof(_Bitfield) * 8),
-                "EventQueue error: _Bitfield type too small for _capacity!");
+  static_assert(_capacity > 0 && _capacity <= 128,
+                "EventQueue error: _capacity must be between 1 and 128!");
 
  private:
+  uint8_t    head_{0};
   uint8_t    length_{0};
   KeyAddr    addrs_[_capacity];
   _Timestamp timestamps_[_capacity]; // NOLINT(runtime/arrays)
-  _Bitfield  release_event_bits_;
+  uint8_t    release_event_bits_[(_capacity + 7) / 8]; // NOLINT(runtime/arrays)
+
+  // The position in the arrays of the entry at `index`.
+  uint8_t slot(uint8_t index) const {
+    uint8_t s = head_ + index;
+    return (s >= _capacity) ? s - _capacity : s;
+  }
 
  public:
+  static constexpr uint8_t capacity = _capacity;
+
   uint8_t length() const {
     return length_;
   }
@@ -64,17 +72,18 @@ class KeyAddrEventQueue {
   // the queue, which will terminate when `index >= queue.length()`.
   KeyAddr addr(uint8_t index) const {
     // assert(index < length_);
-    return addrs_[index];
+    return addrs_[slot(index)];
   }
 
   _Timestamp timestamp(uint8_t index) const {
     // assert(index < length_);
-    return timestamps_[index];
+    return timestamps_[slot(index)];
   }
 
   bool isRelease(uint8_t index) const {
     // assert(index < length_);
-    return bitRead(release_event_bits_, index);
+    uint8_t s = slot(index);
+    return bitRead(release_event_bits_[s / 8], s % 8);
   }
   bool isPress(uint8_t index) const {
     // assert(index < length_);
@@ -85,30 +94,24 @@ class KeyAddrEventQueue {
   // for bounds checking; we don't guard against it here.
   void append(KeyAddr k, uint8_t keyswitch_state) {
     // assert(length_ < _capacity);
-    addrs_[length_]      = k;
-    timestamps_[length_] = Runtime.millisAtCycleStart();
-    bitWrite(release_event_bits_, length_, keyToggledOff(keyswitch_state));
+    uint8_t s = slot(length_);
+    addrs_[s]      = k;
+    timestamps_[s] = Runtime.millisAtCycleStart();
+    bitWrite(release_event_bits_[s / 8], s % 8, keyToggledOff(keyswitch_state));
     ++length_;
   }
 
-  // Remove the first event from the head of the queue, shifting the
-  // others. This function actually shifts the queue by copying element values,
-  // rather than using a ring buffer because we expect it will be called much
-  // less often than the queue is searched via a for loop.
+  // Remove the first event from the head of the queue.
   void shift() {
     // assert(length > 0);
     --length_;
-    for (uint8_t i{0}; i < length_; ++i) {
-      addrs_[i]      = addrs_[i + 1];
-      timestamps_[i] = timestamps_[i + 1];
-    }
-    release_event_bits_ >>= 1;
+    head_ = slot(1);
   }
 
   // Empty the queue entirely.
   void clear() {
-    length_             = 0;
-    release_event_bits_ = 0;
+    head_   = 0;
+    length_ = 0;
   }
 };
 
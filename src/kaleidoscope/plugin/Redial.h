@@ -31,6 +31,9 @@ class Redial : public kaleidoscope::Plugin {
 
   static bool shouldRemember(Key mappedKey);
 
+  typedef kaleidoscope::key_routing::KeyRange<kaleidoscope::ranges::REDIAL,
+                                              kaleidoscope::ranges::REDIAL> HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state);
 
  private:
@@ -24,6 +24,9 @@ namespace plugin {
 
 class ShapeShifter : public kaleidoscope::Plugin {
  public:
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   typedef struct {
     Key original, replacement;
   } dictionary_t;
@@ -33,6 +33,9 @@ namespace plugin {
 
 class SpaceCadet : public kaleidoscope::Plugin {
  public:
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   //Internal Class
   //Declarations for the modifier key mapping
   class KeyBinding {
@@ -29,6 +29,10 @@ namespace plugin {
 
 class Syster : public kaleidoscope::Plugin {
  public:
+  typedef kaleidoscope::key_routing::KeyRange<Key_Backspace.getRaw(),
+                                              Key_Backspace.getRaw()> ProducedKeys;
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+
   typedef enum {
     StartAction,
     EndAction,
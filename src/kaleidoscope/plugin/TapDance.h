@@ -32,6 +32,10 @@ namespace kaleidoscope {
 namespace plugin {
 class TapDance : public kaleidoscope::Plugin {
  public:
+  typedef kaleidoscope::key_routing::AnyKey ProducedKeys;
+  typedef kaleidoscope::key_routing::KeyRange<kaleidoscope::ranges::TD_FIRST,
+                                              kaleidoscope::ranges::TD_LAST> HeldKeys;
+
   typedef enum {
     Tap,
     Hold,
@@ -32,8 +32,7 @@ cRGB Turbo::activeColor_ = CRGB(160, 0, 0);
 bool Turbo::enable = false;
 uint32_t Turbo::startTime = 0;
 uint32_t Turbo::flashStartTime = 0;
-KeyAddr Turbo::keyPositions[4];
-uint16_t Turbo::numKeys = 0;
+KeyIndex Turbo::turbo_keys_(Key_Turbo);
 
 uint16_t Turbo::interval() {
   return interval_;
@@ -70,23 +69,8 @@ void Turbo::activeColor(cRGB newVal) {
   activeColor_ = newVal;
 }
 
-void Turbo::findKeyPositions() {
-  numKeys = 0;
-
-  for (auto key_addr : KeyAddr::all()) {
-    if (Layer.lookupOnActiveLayer(key_addr) == Key_Turbo) {
-      keyPositions[numKeys++] = key_addr;
-    }
-  }
-}
-
 EventHandlerResult Turbo::onSetup() {
-  Turbo::findKeyPositions();
-  return EventHandlerResult::OK;
-}
-
-EventHandlerResult Turbo::onLayerChange() {
-  Turbo::findKeyPositions();
+  Layer.addKeyIndex(turbo_keys_);
   return EventHandlerResult::OK;
 }
 
@@ -94,8 +78,8 @@ EventHandlerResult Turbo::onKeyswitchEvent(Key &key, KeyAddr key_addr, uint8_t k
   if (key != Key_Turbo) return EventHandlerResult::OK;
   enable = sticky_ ? (keyIsPressed(key_state) ? enable : !enable) : keyIsPressed(key_state);
   if (!enable) {
-    for (uint16_t i = 0; i < numKeys; i++) {
-      LEDControl::refreshAt(KeyAddr(keyPositions[i]));
+    for (auto key_addr : turbo_keys_) {
+      LEDControl::refreshAt(key_addr);
     }
   }
   return EventHandlerResult::EVENT_CONSUMED;
@@ -110,19 +94,19 @@ EventHandlerResult Turbo::afterEachCycle() {
 
     if (flash_) {
       if (Runtime.millisAtCycleStart() - flashStartTime > flashInterval_ * 2) {
-        for (uint16_t i = 0; i < numKeys; i++) {
-          LEDControl::setCrgbAt(KeyAddr(keyPositions[i]), activeColor_);
+        for (auto key_addr : turbo_keys_) {
+          LEDControl::setCrgbAt(key_addr, activeColor_);
         }
         flashStartTime = Runtime.millisAtCycleStart();
       } else if (Runtime.millisAtCycleStart() - flashStartTime > flashInterval_) {
-        for (uint16_t i = 0; i < numKeys; i++) {
-          LEDControl::setCrgbAt(KeyAddr(keyPositions[i]), {0, 0, 0});
+        for (auto key_addr : turbo_keys_) {
+          LEDControl::setCrgbAt(key_addr, {0, 0, 0});
         }
       }
       LEDControl::syncLeds();
     } else {
-      for (uint16_t i = 0; i < numKeys; i++) {
-        LEDControl::setCrgbAt(KeyAddr(keyPositions[i]), activeColor_);
+      for (auto key_addr : turbo_keys_) {
+        LEDControl::setCrgbAt(key_addr, activeColor_);
       }
     }
   }
@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include "kaleidoscope/Runtime.h"
+#include "kaleidoscope/layers.h"
 #include <Kaleidoscope-Ranges.h>
 
 #pragma once
@@ -29,6 +30,9 @@ class Turbo : public kaleidoscope::Plugin {
  public:
   Turbo() {}
 
+  typedef kaleidoscope::key_routing::KeyRange<kaleidoscope::ranges::TURBO,
+                                              kaleidoscope::ranges::TURBO> RoutedKeys;
+
   uint16_t interval();
   void interval(uint16_t newVal);
 
@@ -45,12 +49,9 @@ class Turbo : public kaleidoscope::Plugin {
   void activeColor(cRGB newVal);
 
   EventHandlerResult onSetup();
-  EventHandlerResult onLayerChange();
   EventHandlerResult onKeyswitchEvent(Key &key, KeyAddr key_addr, uint8_t key_state);
   EventHandlerResult afterEachCycle();
  private:
-  void findKeyPositions();
-
   static uint16_t interval_;
   static uint16_t flashInterval_;
   static bool sticky_;
@@ -60,8 +61,7 @@ class Turbo : public kaleidoscope::Plugin {
   static bool enable;
   static uint32_t startTime;
   static uint32_t flashStartTime;
-  static KeyAddr keyPositions[4];
-  static uint16_t numKeys;
+  static KeyIndex turbo_keys_;
 };
 }
 }
@@ -21,6 +21,14 @@ namespace kaleidoscope {
 namespace plugin {
 
 uint8_t Unicode::input_delay_;
+uint32_t Unicode::queue_[];
+uint8_t Unicode::queue_head_;
+uint8_t Unicode::queue_length_;
+Key Unicode::steps_[];
+uint8_t Unicode::step_delays_[];
+uint8_t Unicode::step_count_;
+uint8_t Unicode::step_pos_;
+uint16_t Unicode::step_start_;
 
 void Unicode::start(void) {
   switch (::HostOS.os()) {
@@ -126,10 +134,147 @@ void Unicode::typeCode(uint32_t unicode) {
   }
 }
 
+void Unicode::addStep(Key key, uint16_t delay) {
+  steps_[step_count_] = key;
+  step_delays_[step_count_] = delay > 255 ? 255 : delay;
+  step_count_++;
+}
+
+// Turns a code point into the list of reports that type it on the current host
+// OS, the same ones `start()`, `typeCode()` and `end()` would send. Returns
+// false if the OS is a custom one, where we can't know what those are.
+bool Unicode::compile(uint32_t unicode) {
+  uint8_t hold = 0;
+
+  step_count_ = 0;
+  step_pos_ = 0;
+
+  switch (::HostOS.os()) {
+  case hostos::LINUX:
+    addStep(Key(Key_U.getKeyCode(), CTRL_HELD | SHIFT_HELD), 0);
+    addStep(Key_NoKey, 0);
+    break;
+  case hostos::WINDOWS:
+    hold = LALT_HELD;
+    addStep(Key(0, hold), 0);
+    addStep(Key(Key_KeypadAdd.getKeyCode(), hold), 0);
+    addStep(Key(0, hold), 0);
+    break;
+  case hostos::OSX:
+    hold = LALT_HELD;
+    break;
+  default:
+    return false;
+  }
+
+  // At least four digits, without the leading zeros before them.
+  bool first = true;
+  for (int8_t i = 7; i >= 0; i--) {
+    uint8_t digit = (unicode >> (i * 4)) & 0xF;
+    if (first && digit == 0 && i > 3)
+      continue;
+
+    Key key;
+    if (::HostOS.os() == hostos::WINDOWS) {
+      key = hexToKeysWithNumpad(digit);
+    } else {
+      key = hexToKey(digit);
+    }
+
+    addStep(Key(key.getKeyCode(), key.getFlags() | hold),
+            input_delay_ + (first ? 0 : 5));
+    addStep(Key(0, hold), input_delay_);
+    first = false;
+  }
+
+  if (::HostOS.os() == hostos::LINUX) {
+    addStep(Key_Spacebar, 5);
+  }
+  addStep(Key_NoKey, 5);
+
+  return true;
+}
+
+void Unicode::playStep(Key key) {
+  if (key.getFlags() & CTRL_HELD)
+    kaleidoscope::Runtime.hid().keyboard().pressRawKey(Key_LeftControl);
+  if (key.getFlags() & SHIFT_HELD)
+    kaleidoscope::Runtime.hid().keyboard().pressRawKey(Key_LeftShift);
+  if (key.getFlags() & LALT_HELD)
+    kaleidoscope::Runtime.hid().keyboard().pressRawKey(Key_LeftAlt);
+  if (key.getKeyCode() != 0)
+    kaleidoscope::Runtime.hid().keyboard().pressRawKey(key);
+}
+
+void Unicode::startNext() {
+  while (queue_length_ != 0) {
+    uint32_t unicode = queue_[queue_head_];
+    queue_head_ = (queue_head_ + 1) % UNICODE_QUEUE_SIZE;
+    queue_length_--;
+
+    if (compile(unicode)) {
+      step_start_ = Runtime.millisAtCycleStart();
+      return;
+    }
+
+    // A custom OS: fall back to the callbacks, right away.
+    step_count_ = 0;
+    start();
+    typeCode(unicode);
+    end();
+  }
+}
+
 void Unicode::type(uint32_t unicode) {
-  start();
-  typeCode(unicode);
-  end();
+  if (queue_length_ == UNICODE_QUEUE_SIZE)
+    flush();
+
+  queue_[(queue_head_ + queue_length_) % UNICODE_QUEUE_SIZE] = unicode;
+  queue_length_++;
+}
+
+// Plays the rest of the queue right away, waiting between the reports with
+// `delay()`.
+void Unicode::flush() {
+  while (busy()) {
+    if (step_count_ == 0) {
+      startNext();
+      continue;
+    }
+
+    delay(step_delays_[step_pos_]);
+    kaleidoscope::Runtime.hid().keyboard().releaseAllKeys();
+    playStep(steps_[step_pos_]);
+    kaleidoscope::Runtime.hid().keyboard().sendReport();
+
+    if (++step_pos_ == step_count_)
+      step_count_ = 0;
+  }
+}
+
+// Sends one report of the current code point per cycle. Other keys are left out
+// of the report while a code point is being typed, so they don't get mixed into
+// the sequence. Until it is time for the next step, the previous one is repeated.
+EventHandlerResult Unicode::beforeReportingState() {
+  if (step_count_ == 0)
+    startNext();
+  if (step_count_ == 0)
+    return EventHandlerResult::OK;
+
+  kaleidoscope::Runtime.hid().keyboard().releaseAllKeys();
+
+  uint16_t elapsed = static_cast<uint16_t>(Runtime.millisAtCycleStart()) - step_start_;
+  if (elapsed >= step_delays_[step_pos_]) {
+    step_start_ = Runtime.millisAtCycleStart();
+    playStep(steps_[step_pos_]);
+
+    if (++step_pos_ == step_count_)
+      step_count_ = 0;
+  } else if (step_pos_ != 0) {
+    playStep(steps_[step_pos_ - 1]);
+  }
+
+  return EventHandlerResult::OK;
 }
 
 }
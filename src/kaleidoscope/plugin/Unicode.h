@@ -20,6 +20,10 @@
 #include "kaleidoscope/Runtime.h"
 #include <Kaleidoscope-HostOS.h>
 
+#if !defined(UNICODE_QUEUE_SIZE)
+#define UNICODE_QUEUE_SIZE 8
+#endif
+
 namespace kaleidoscope {
 namespace plugin {
 class Unicode : public kaleidoscope::Plugin {
@@ -33,14 +37,41 @@ class Unicode : public kaleidoscope::Plugin {
   static void type(uint32_t unicode);
   static void typeCode(uint32_t unicode);
 
+  static bool busy() {
+    return step_count_ != 0 || queue_length_ != 0;
+  }
+  static void flush();
+
   static void input_delay(uint8_t delay) {
     input_delay_ = delay;
   }
   static uint8_t input_delay() {
     return input_delay_;
   }
+
+  EventHandlerResult beforeReportingState();
+
  private:
   static uint8_t input_delay_;
+
+  // Code points waiting to be typed.
+  static uint32_t queue_[UNICODE_QUEUE_SIZE];
+  static uint8_t queue_head_;
+  static uint8_t queue_length_;
+
+  // The reports that type the current code point: one key (with modifier
+  // flags) per report, and the time to wait before sending each.
+  static constexpr uint8_t max_steps_ = 20;
+  static Key steps_[max_steps_];
+  static uint8_t step_delays_[max_steps_];
+  static uint8_t step_count_;
+  static uint8_t step_pos_;
+  static uint16_t step_start_;
+
+  static bool compile(uint32_t unicode);
+  static void addStep(Key key, uint16_t delay);
+  static void playStep(Key key);
+  static void startNext();
 };
 }
 }
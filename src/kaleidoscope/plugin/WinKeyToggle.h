@@ -25,6 +25,11 @@ class WinKeyToggle: public kaleidoscope::Plugin {
  public:
   WinKeyToggle() {}
 
+  typedef kaleidoscope::key_routing::AnyOf <
+  kaleidoscope::key_routing::KeyRange<Key_LeftGui.getRaw(), Key_LeftGui.getRaw()>,
+  kaleidoscope::key_routing::KeyRange<Key_RightGui.getRaw(), Key_RightGui.getRaw()>
+  > HeldKeys;
+
   EventHandlerResult onKeyswitchEvent(Key &key, KeyAddr key_addr, uint8_t key_state);
   void toggle() {
     enabled_ = !enabled_;
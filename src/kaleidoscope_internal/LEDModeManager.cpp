@@ -48,6 +48,13 @@ kaleidoscope::plugin::LEDMode *LEDModeManager::getLEDMode(uint8_t mode_id) {
     return cur_led_mode;
   }
 
+  // Let the current LED mode know it is being replaced, while it still
+  // exists.
+  //
+  if (cur_led_mode) {
+    cur_led_mode->onDeactivate();
+  }
+
   // If there is already an active LED mode, its obviously the wrong one
   // (see test above). To generate a new transient LED mode, we need
   // to destroy the current one. To achieve this, we call its
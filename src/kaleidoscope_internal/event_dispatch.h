@@ -36,8 +36,11 @@
 #include "kaleidoscope/macro_helpers.h"
 #include "kaleidoscope/plugin.h"
 #include "kaleidoscope/hooks.h"
+#include "kaleidoscope/hook_profiling.h"
 #include "kaleidoscope_internal/eventhandler_signature_check.h"
 #include "kaleidoscope/event_handlers.h"
+#include "kaleidoscope/key_routing.h"
+#include "kaleidoscope/keyswitch_state.h"
 #include "kaleidoscope_internal/sketch_exploration/sketch_exploration.h"
 
 // Some words about the design of hook routing:
@@ -120,6 +123,15 @@
         return SHOULD_ABORT_ON_CONSUMED_EVENT;                            __NL__ \
       }                                                                   __NL__ \
                                                                           __NL__ \
+      static constexpr uint8_t hook_index =                               __NL__ \
+         kaleidoscope::hook_profiling::_NAME3(HOOK_NAME, _v, HOOK_VERSION); __NL__ \
+                                                                          __NL__ \
+      template<typename Plugin__>                                         __NL__ \
+      static constexpr bool isImplementedBy() {                           __NL__ \
+        return HookVersionImplemented_##HOOK_NAME<                        __NL__ \
+                 Plugin__, HOOK_VERSION>::value;                          __NL__ \
+      }                                                                   __NL__ \
+                                                                          __NL__ \
       template<typename Plugin__,                                         __NL__ \
                typename... Args__>                                        __NL__ \
       static kaleidoscope::EventHandlerResult                             __NL__ \
@@ -162,15 +174,193 @@
                                                                           __NL__ \
    }
 
+namespace kaleidoscope_internal {
+
+// Decides whether a plugin's event handler should be called at all. Only the
+// key event handlers are routed: for those, plugins that declare a
+// `RoutedKeys` type (see key_routing.h) are skipped for keys it does not
+// match. The key is checked when the plugin's turn comes, because the plugins
+// before it may have changed it.
+template<uint8_t hook_index__>
+struct KeyRouter {
+  template<typename Plugin__, typename... Args__>
+  static constexpr bool routes(Args__&&... /*hook_args*/) {
+    return true;
+  }
+};
+
+#if KALEIDOSCOPE_KEYMAP_PRUNING
+
+// Whether any plugin in the list, other than Plugin__ itself, declares
+// ProducedKeys that may overlap with Route__.
+template<typename PluginTypeList__, typename Plugin__, typename Route__>
+struct OthersProduce {
+  typedef typename PluginTypeList__::Plugin Other__;
+
+  static constexpr bool value =
+    (!std::is_same<Other__, Plugin__>::value &&
+     kaleidoscope::key_routing::Overlap<
+     typename kaleidoscope::key_routing::ProducedKeysOf<Other__>::type,
+     Route__>::value) ||
+    OthersProduce<typename PluginTypeList__::Next, Plugin__, Route__>::value;
+};
+
+template<typename Plugin__, typename Route__>
+struct OthersProduce<kaleidoscope::sketch_exploration::EmptyPluginTypeList,
+    Plugin__, Route__> {
+  static constexpr bool value = false;
+};
+
+// Whether any of the keys Plugin__ is routed can ever come up. The sketch is
+// a template parameter so that it is only looked at when the key event
+// handlers are instantiated, by which time both KEYMAPS(...) and
+// KALEIDOSCOPE_INIT_PLUGINS(...) have been seen.
+template<typename Plugin__,
+         typename Sketch__ = kaleidoscope::sketch_exploration::Sketch>
+struct IsReachable {
+  typedef typename kaleidoscope::key_routing::RoutedKeysOf<Plugin__>::type Route__;
+
+  static constexpr bool value =
+    std::is_same<Route__, kaleidoscope::key_routing::AnyKey>::value ||
+    Sketch__::StaticKeymap::collect(
+      kaleidoscope::sketch_exploration::HasKeyMatching<Route__> {}) ||
+    OthersProduce<typename Sketch__::Plugins::TypeList, Plugin__, Route__>::value;
+};
+
+#else
+
+template<typename Plugin__>
+struct IsReachable {
+  static constexpr bool value = true;
+};
+
+#endif
+
+template<typename Plugin__>
+constexpr bool routesKey(const Key &key) {
+  return IsReachable<Plugin__>::value &&
+         kaleidoscope::key_routing::RoutedKeysOf<Plugin__>::type::matches(key);
+}
+
+// With KALEIDOSCOPE_KEYSWITCH_TOGGLE_EVENTS_ONLY, physical keys that are held
+// (neither toggled on nor off this cycle) only go to the plugins that asked
+// for them with `HeldKeys`.
+constexpr bool isHeld(KeyAddr key_addr, uint8_t key_state) {
+  return KALEIDOSCOPE_KEYSWITCH_TOGGLE_EVENTS_ONLY &&
+         key_addr.isValid() && !(key_state & INJECTED) &&
+         keyIsPressed(key_state) && keyWasPressed(key_state);
+}
+
+template<>
+struct KeyRouter<kaleidoscope::hook_profiling::onKeyswitchEvent_v1> {
+  template<typename Plugin__>
+  static constexpr bool routes(const Key &key, KeyAddr key_addr, uint8_t key_state) {
+    return routesKey<Plugin__>(key) &&
+           (!isHeld(key_addr, key_state) ||
+            kaleidoscope::key_routing::HeldKeysOf<Plugin__>::type::matches(key));
+  }
+};
+
+template<typename EventHandler__, typename Plugin__, typename... Args__>
+constexpr bool isRouted(Plugin__ &/*plugin*/, Args__&&... hook_args) {
+  return KeyRouter<EventHandler__::hook_index>::template routes<Plugin__>(hook_args...);
+}
+
+}
+
+#if KALEIDOSCOPE_HOOK_PROFILING
+
+namespace kaleidoscope_internal {
+
+// Calls a plugin's event handler, and records how long it took. Plugins that
+// do not implement the hook are not timed, so they do not show up in the
+// profile.
+template<typename EventHandler__, typename Plugin__, typename... Args__>
+kaleidoscope::EventHandlerResult profileEventHandler(uint8_t plugin_index,
+    Plugin__ &plugin,
+    Args__&&... hook_args) {
+  if (!EventHandler__::template isImplementedBy<Plugin__>())
+    return EventHandler__::call(plugin, hook_args...);
+
+  uint32_t start = kaleidoscope::hook_profiling::clock();
+  kaleidoscope::EventHandlerResult result = EventHandler__::call(plugin, hook_args...);
+  kaleidoscope::hook_profiling::record(plugin_index, EventHandler__::hook_index,
+                                       kaleidoscope::hook_profiling::clock() - start);
+  return result;
+}
+
+}
+
+#define _PROFILING_PLUGIN_INDEX                                             \
+   uint8_t plugin_index__ = 0;
+
 #define _INLINE_EVENT_HANDLER_FOR_PLUGIN(PLUGIN)                            \
                                                                      __NL__ \
-   result = EventHandler__::call(PLUGIN, hook_args...);              __NL__ \
+   if (isRouted<EventHandler__>(PLUGIN, hook_args...))               __NL__ \
+     result = profileEventHandler<EventHandler__>(plugin_index__,    __NL__ \
+                                                  PLUGIN,            __NL__ \
+                                                  hook_args...);     __NL__ \
+   else                                                              __NL__ \
+     result = kaleidoscope::EventHandlerResult::OK;                  __NL__ \
+   plugin_index__++;                                                 __NL__ \
                                                                      __NL__ \
    if (EventHandler__::shouldAbortOnConsumedEvent() &&               __NL__ \
        result == kaleidoscope::EventHandlerResult::EVENT_CONSUMED) { __NL__ \
       return result;                                                 __NL__ \
    }                                                                 __NL__
 
+#define _HOOK_PROFILING_COUNT_PLUGIN(PLUGIN) + 1
+#define _HOOK_PROFILING_PLUGIN_NAME(PLUGIN) #PLUGIN "\n"
+
+// The profile table, and the functions declared in hook_profiling.h that
+// give access to it.
+#define _INIT_HOOK_PROFILING(...)                                           \
+  namespace kaleidoscope {                                           __NL__ \
+  namespace hook_profiling {                                         __NL__ \
+                                                                     __NL__ \
+    static Entry entries__[0 MAP(_HOOK_PROFILING_COUNT_PLUGIN,       __NL__ \
+                                 __VA_ARGS__)][hook_count];          __NL__ \
+                                                                     __NL__ \
+    Entry *entry(uint8_t plugin_index, uint8_t hook_index) {         __NL__ \
+      return &entries__[plugin_index][hook_index];                   __NL__ \
+    }                                                                __NL__ \
+                                                                     __NL__ \
+    void reset() {                                                   __NL__ \
+      memset(entries__, 0, sizeof(entries__));                       __NL__ \
+    }                                                                __NL__ \
+                                                                     __NL__ \
+    const char *pluginNames() {                                      __NL__ \
+      return PSTR(MAP(_HOOK_PROFILING_PLUGIN_NAME, __VA_ARGS__));    __NL__ \
+    }                                                                __NL__ \
+                                                                     __NL__ \
+  }                                                                  __NL__ \
+  }
+
+#else // KALEIDOSCOPE_HOOK_PROFILING
+
+#define _PROFILING_PLUGIN_INDEX
+
+#define _INLINE_EVENT_HANDLER_FOR_PLUGIN(PLUGIN)                            \
+                                                                     __NL__ \
+   if (isRouted<EventHandler__>(PLUGIN, hook_args...))               __NL__ \
+     result = EventHandler__::call(PLUGIN, hook_args...);            __NL__ \
+   else                                                              __NL__ \
+     result = kaleidoscope::EventHandlerResult::OK;                  __NL__ \
+                                                                     __NL__ \
+   if (EventHandler__::shouldAbortOnConsumedEvent() &&               __NL__ \
+       result == kaleidoscope::EventHandlerResult::EVENT_CONSUMED) { __NL__ \
+      return result;                                                 __NL__ \
+   }                                                                 __NL__
+
+#define _INIT_HOOK_PROFILING(...)
+
+#endif // KALEIDOSCOPE_HOOK_PROFILING
+
+#define _INLINE_EVENT_HANDLER_FOR_NTH_PLUGIN(PLUGIN)                       \
+                                                                     __NL__ \
+   if (plugin_index == index__++)                                    __NL__ \
+      return EventHandler__::call(PLUGIN, hook_args...);             __NL__
+
 // _KALEIDOSCOPE_INIT_PLUGINS builds the loops that execute the plugins'
 // implementations of the various event handlers.
 //
@@ -191,9 +381,22 @@
     static kaleidoscope::EventHandlerResult apply(Args__&&... hook_args) {    __NL__ \
                                                                               __NL__ \
       kaleidoscope::EventHandlerResult result;                                __NL__ \
+      _PROFILING_PLUGIN_INDEX                                                 __NL__ \
       MAP(_INLINE_EVENT_HANDLER_FOR_PLUGIN, __VA_ARGS__)                      __NL__ \
                                                                               __NL__ \
       return result;                                                          __NL__ \
+    }                                                                         __NL__ \
+                                                                              __NL__ \
+    /* Call the event handler of a single plugin, the one at position      */ __NL__ \
+    /* plugin_index                                                        */ __NL__ \
+    template<typename EventHandler__, typename... Args__ >                    __NL__ \
+    static kaleidoscope::EventHandlerResult                                   __NL__ \
+      applyTo(uint8_t plugin_index, Args__&&... hook_args) {                  __NL__ \
+                                                                              __NL__ \
+      uint8_t index__ = 0;                                                    __NL__ \
+      MAP(_INLINE_EVENT_HANDLER_FOR_NTH_PLUGIN, __VA_ARGS__)                  __NL__ \
+                                                                              __NL__ \
+      return kaleidoscope::EventHandlerResult::OK;                            __NL__ \
     }                                                                         __NL__ \
   };                                                                          __NL__ \
                                                                               __NL__ \
@@ -216,4 +419,21 @@
   /* LEDModeFactory entries                                                */ __NL__ \
   _INIT_LED_MODE_MANAGER(__VA_ARGS__)                                         __NL__ \
                                                                               __NL__ \
-  _INIT_PLUGIN_EXPLORATION(__VA_ARGS__)
+  _INIT_PLUGIN_EXPLORATION(__VA_ARGS__)                                       __NL__ \
+                                                                              __NL__ \
+  _INIT_HOOK_PROFILING(__VA_ARGS__)                                           __NL__ \
+                                                                              __NL__ \
+  namespace kaleidoscope {                                                    __NL__ \
+                                                                              __NL__ \
+    EventHandlerResult Hooks::onFocusEventFor(uint8_t plugin_index,           __NL__ \
+                                              const char *command) {          __NL__ \
+      return kaleidoscope_internal::EventDispatcher::template                 __NL__ \
+        applyTo<kaleidoscope_internal::EventHandler_onFocusEvent_v1>          __NL__ \
+          (plugin_index, command);                                            __NL__ \
+    }                                                                         __NL__ \
+                                                                              __NL__ \
+    uint8_t Hooks::pluginCount() {                                            __NL__ \
+      return sketch_exploration::Plugins::size;                               __NL__ \
+    }                                                                         __NL__ \
+                                                                              __NL__ \
+  }
@@ -175,6 +175,21 @@ struct HasKey {
   Key k_;
 };
 
+// Whether any key matches _Route, one of the routes of key_routing.h.
+//
+template<typename _Route>
+struct HasKeyMatching {
+  typedef bool ResultType;
+  static constexpr ResultType init_value = false;
+
+  constexpr ResultType apply(Key test_key, ResultType r) const {
+    return _Route::matches(test_key) ? true : r;
+  }
+  constexpr ResultType apply(ResultType r1, ResultType r2) const {
+    return r1 || r2;
+  }
+};
+
 // This class is actually defined and implemented in _INIT_KEYMAP_EXPLORATION
 // which is invoked by KALEIDOSCOPE_INIT_PLUGINS
 //
@@ -135,6 +135,8 @@ struct Plugins__ {
 
   static constexpr int size = _PluginTypeList::size;
 
+  typedef _PluginTypeList TypeList;
+
   // C++11 does not allow for template specialization to havven
   // in non-namespace scope. Thus, we define those templates
   // in namespace scope and then using declare their types here.
@@ -19,6 +19,16 @@
 #include "kaleidoscope_internal/sketch_exploration/keymap_exploration.h"
 #include "kaleidoscope_internal/sketch_exploration/plugin_exploration.h"
 
+namespace kaleidoscope {
+namespace sketch_exploration {
+
+// Defined in _INIT_SKETCH_EXPLORATION, which is invoked by KEYMAPS(...)
+//
+struct Sketch;
+
+} // namespace sketch_exploration
+} // namespace kaleidoscope
+
 //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // Read carefully
 //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -0,0 +1,203 @@
+/* kailedoscope::sim - Benchmark runner for the virtual device
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/Benchmark.h"
+
+#include "kaleidoscope/hook_profiling.h"
+#include "kaleidoscope/key_trace.h"
+#include "testing/HIDState.h"
+
+#include "testing/fix-macros.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <string>
+
+namespace kaleidoscope {
+namespace testing {
+
+double Benchmark::Result::EventsPerSecond() const {
+  return seconds > 0 ? events / seconds : 0;
+}
+
+double Benchmark::Result::CyclesPerSecond() const {
+  return seconds > 0 ? cycles / seconds : 0;
+}
+
+void Benchmark::RunCycle(Result &result) {
+  sim_.RunCycle();
+  result.cycles++;
+
+  // The reports would otherwise pile up for the whole run.
+  result.keyboard_reports += internal::HIDStateBuilder::Snapshot()->Keyboard().size();
+}
+
+Benchmark::Result Benchmark::Run(const std::vector<TraceEvent> &trace) {
+  Result result;
+  auto &scanner = Kaleidoscope.device().keyScanner();
+
+  // Key states are set directly, there is no input to parse.
+  scanner.setEnableReadMatrix(false);
+  // Drop any reports left over from before the run.
+  internal::HIDStateBuilder::Snapshot();
+
+  auto wall_start = std::chrono::steady_clock::now();
+  uint32_t start = Kaleidoscope.millisAtCycleStart();
+
+  for (const auto &event : trace) {
+    while (Kaleidoscope.millisAtCycleStart() - start < event.time)
+      RunCycle(result);
+
+    if (event.pressed) {
+      sim_.Press(event.key_addr);
+    } else {
+      sim_.Release(event.key_addr);
+    }
+    result.events++;
+  }
+  RunCycle(result);
+
+  for (auto key_addr : KeyAddr::all())
+    sim_.Release(key_addr);
+  RunCycle(result);
+
+  result.seconds = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - wall_start).count();
+  result.simulated_millis = Kaleidoscope.millisAtCycleStart() - start;
+
+  scanner.setEnableReadMatrix(true);
+  return result;
+}
+
+// A xorshift generator: <random> does not get along with the Arduino macros,
+// and the traces only need to be cheap and repeatable.
+static uint32_t nextRandom(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+std::vector<TraceEvent> Benchmark::RandomTaps(size_t taps, uint32_t seed,
+                                              uint16_t mean_gap) {
+  uint32_t state = seed ? seed : 1;
+  std::vector<TraceEvent> trace;
+  trace.reserve(2 * taps);
+
+  uint32_t time = 0;
+  for (size_t i = 0; i < taps; i++) {
+    KeyAddr key_addr(uint8_t(nextRandom(state) % KeyAddr::upper_limit));
+
+    time += 1 + nextRandom(state) % (2 * mean_gap);
+    trace.push_back({time, key_addr, true});
+    trace.push_back({time + 20 + nextRandom(state) % 81, key_addr, false});
+  }
+
+  std::stable_sort(trace.begin(), trace.end(),
+  [](const TraceEvent & a, const TraceEvent & b) {
+    return a.time < b.time;
+  });
+  return trace;
+}
+
+std::vector<TraceEvent> Benchmark::ReadTrace(const uint8_t *data, size_t size) {
+  key_trace::Reader reader(data, size);
+  std::vector<TraceEvent> trace;
+  uint32_t time = 0;
+
+  if (!key_trace::isValidHeader(data, size) ||
+      key_trace::keyCount(data) != KeyAddr::upper_limit)
+    return trace;
+
+  trace.reserve(size / key_trace::record_size);
+  while (!reader.done()) {
+    key_trace::Record record = reader.read();
+    KeyAddr key_addr(record.key);
+
+    time += record.delta;
+    if (record.key != key_trace::idle_key && key_addr.isValid())
+      trace.push_back({time, key_addr, record.pressed});
+  }
+  return trace;
+}
+
+void Benchmark::PrintResult(std::ostream &out, const Result &result) {
+  out << std::fixed << std::setprecision(0)
+      << result.events << " events, "
+      << result.cycles << " cycles, "
+      << result.keyboard_reports << " keyboard reports, "
+      << result.simulated_millis << " simulated ms in "
+      << std::setprecision(3) << result.seconds << " s: "
+      << std::setprecision(0)
+      << result.EventsPerSecond() << " events/s, "
+      << result.CyclesPerSecond() << " cycles/s"
+      << std::endl;
+}
+
+static std::vector<std::string> splitNames(const char *names) {
+  std::vector<std::string> result;
+  std::string name;
+
+  for (const char *c = names; *c; c++) {
+    if (*c == '\n') {
+      result.push_back(name);
+      name.clear();
+    } else {
+      name += *c;
+    }
+  }
+  return result;
+}
+
+void Benchmark::PrintHookProfile(std::ostream &out) {
+  if (hook_profiling::entry(0, 0) == nullptr) {
+    out << "hook profiling is not enabled in this sketch" << std::endl;
+    return;
+  }
+
+  auto plugins = splitNames(hook_profiling::pluginNames());
+  auto hooks = splitNames(hook_profiling::hookNames());
+
+  out << std::left
+      << std::setw(24) << "plugin"
+      << std::setw(28) << "hook"
+      << std::right
+      << std::setw(12) << "calls"
+      << std::setw(12) << "total us"
+      << std::setw(10) << "max us"
+      << std::endl;
+
+  for (uint8_t p = 0; p < plugins.size(); p++) {
+    for (uint8_t h = 0; h < hooks.size() && h < hook_profiling::hook_count; h++) {
+      const hook_profiling::Entry *e = hook_profiling::entry(p, h);
+
+      if (e->count == 0)
+        continue;
+
+      out << std::left
+          << std::setw(24) << plugins[p]
+          << std::setw(28) << hooks[h]
+          << std::right
+          << std::setw(12) << e->count
+          << std::setw(12) << e->total
+          << std::setw(10) << e->max
+          << std::endl;
+    }
+  }
+}
+
+}  // namespace testing
+}  // namespace kaleidoscope
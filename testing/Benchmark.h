@@ -0,0 +1,85 @@
+/* kailedoscope::sim - Benchmark runner for the virtual device
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Kaleidoscope.h"
+#include "testing/SimHarness.h"
+#include "testing/fix-macros.h"
+
+#include <ostream>
+#include <vector>
+
+namespace kaleidoscope {
+namespace testing {
+
+// A single keyswitch event of a trace. `time` is in milliseconds, relative to
+// the start of the trace; events must be sorted by it.
+struct TraceEvent {
+  uint32_t time;
+  KeyAddr key_addr;
+  bool pressed;
+};
+
+// Replays key event traces through the real `Kaleidoscope.loop()`, as fast as
+// the host can run it. Time is simulated, so a trace spanning hours of typing
+// runs without waiting; the runner measures the wall-clock time it took.
+//
+// If the sketch is built with KALEIDOSCOPE_HOOK_PROFILING, the per-plugin,
+// per-hook cost of the run can be printed with `PrintHookProfile()`.
+class Benchmark {
+ public:
+  struct Result {
+    size_t events = 0;
+    size_t cycles = 0;
+    size_t keyboard_reports = 0;
+    uint32_t simulated_millis = 0;
+    double seconds = 0;
+
+    double EventsPerSecond() const;
+    double CyclesPerSecond() const;
+  };
+
+  explicit Benchmark(SimHarness &sim) : sim_(sim) {}
+
+  // Runs the trace to the end, then releases every key it left pressed.
+  Result Run(const std::vector<TraceEvent> &trace);
+
+  // Generates a trace of `taps` overlapping taps of random keys, with gaps
+  // between presses of up to twice `mean_gap` milliseconds, and holds of 20 to
+  // 100 milliseconds. The same seed always generates the same trace.
+  static std::vector<TraceEvent> RandomTaps(size_t taps,
+                                            uint32_t seed = 1,
+                                            uint16_t mean_gap = 40);
+
+  // Converts a binary trace, as recorded by the KeyTrace plugin, to events.
+  // A trace recorded on a device with a different number of keys yields none.
+  static std::vector<TraceEvent> ReadTrace(const uint8_t *data, size_t size);
+
+  static void PrintResult(std::ostream &out, const Result &result);
+  static void PrintHookProfile(std::ostream &out);
+
+ private:
+  SimHarness &sim_;
+
+  void RunCycle(Result &result);
+};
+
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,72 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define KALEIDOSCOPE_HOOK_PROFILING 1
+
+#include <Kaleidoscope.h>
+#include <Kaleidoscope-Qukeys.h>
+#include <Kaleidoscope-OneShot.h>
+
+// *INDENT-OFF*
+KEYMAPS(
+  [0] = KEYMAP_STACKED
+  (
+      Key_NoKey,    Key_1, Key_2, Key_3, Key_4, Key_5, Key_NoKey,
+      Key_Backtick, Key_Q, Key_W, Key_E, Key_R, Key_T, Key_Tab,
+      Key_PageUp,   Key_A, Key_S, Key_D, Key_F, Key_G,
+      Key_PageDown, Key_Z, Key_X, Key_C, Key_V, Key_B, Key_Escape,
+
+      OSM(LeftControl), Key_Backspace, OSM(LeftGui), OSM(LeftShift),
+      OSL(1),
+
+      Key_NoKey,  Key_6, Key_7,    Key_8,     Key_9,      Key_0,            Key_NoKey,
+      Key_Enter,  Key_Y, Key_U,    Key_I,     Key_O,      Key_P,            Key_Equals,
+                  Key_H, SFT_T(J), CTL_T(K),  ALT_T(L),   GUI_T(Semicolon), Key_Quote,
+      Key_NoKey,  Key_N, Key_M,    Key_Comma, Key_Period, Key_Slash,        Key_Minus,
+
+      OSM(RightShift), OSM(RightAlt), Key_Spacebar, OSM(RightControl),
+      LT(1,E)
+   ),
+  [1] = KEYMAP_STACKED
+  (
+      ___,   Key_F1, Key_F2, Key_F3, Key_F4, Key_F5, ___,
+      ___,   ___,    ___,    ___,    ___,    ___,    ___,
+      ___,   ___,    ___,    ___,    ___,    ___,
+      ___,   ___,    ___,    ___,    ___,    ___,    ___,
+
+      ___, ___, ___, ___,
+      ___,
+
+      ___,   Key_F6, Key_F7,        Key_F8,          Key_F9,         Key_F10, ___,
+      ___,   ___,    ___,           ___,             ___,            ___,     ___,
+             ___,    Key_LeftArrow, Key_DownArrow,   Key_UpArrow,    Key_RightArrow, ___,
+      ___,   ___,    ___,           ___,             ___,            ___,     ___,
+
+      ___, ___, ___, ___,
+      ___
+   ),
+)
+// *INDENT-ON*
+
+KALEIDOSCOPE_INIT_PLUGINS(Qukeys, OneShot);
+
+void setup() {
+  Kaleidoscope.setup();
+}
+
+void loop() {
+  Kaleidoscope.loop();
+}
@@ -0,0 +1,56 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/Benchmark.h"
+#include "kaleidoscope/hook_profiling.h"
+
+#include "testing/setup-googletest.h"
+
+#include <cstdlib>
+#include <iostream>
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+class Typing : public VirtualDeviceTest {};
+
+// The number of taps is kept low enough for the regular test runs. Set
+// KALEIDOSCOPE_BENCHMARK_TAPS to replay millions of them.
+size_t benchmarkTaps() {
+  const char *taps = std::getenv("KALEIDOSCOPE_BENCHMARK_TAPS");
+  return taps ? std::strtoul(taps, nullptr, 10) : 5000;
+}
+
+TEST_F(Typing, RandomTaps) {
+  auto trace = Benchmark::RandomTaps(benchmarkTaps());
+
+  hook_profiling::reset();
+  auto result = Benchmark(sim_).Run(trace);
+
+  Benchmark::PrintResult(std::cout, result);
+  Benchmark::PrintHookProfile(std::cout);
+
+  EXPECT_EQ(result.events, trace.size());
+  EXPECT_GE(result.cycles, trace.back().time);
+  EXPECT_GT(result.keyboard_reports, 0);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,158 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/setup-googletest.h"
+
+#include "kaleidoscope/driver/storage/FlashLog.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr uint16_t image_size = 256;
+constexpr uint16_t log_size = 256;
+
+// Flash, as FlashStorage sees it: writing can only clear bits, erasing sets
+// them. A write can be cut short after `tear_after` bytes, as if the keyboard
+// was reset in the middle of it.
+class FakeFlash {
+ public:
+  int tear_after = -1;
+
+  void write(const volatile void *dst, const void *src, uint32_t size) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    for (uint32_t i = 0; i < size; i++) {
+      if (tear_after >= 0 && i >= (uint32_t)tear_after)
+        return;
+      d[i] &= s[i];
+    }
+  }
+  void erase(const volatile void *dst, uint32_t size) {
+    memset((void *)dst, 0xff, size);
+  }
+  void read(const volatile void *src, void *dst, uint32_t size) {
+    memcpy(dst, (const void *)src, size);
+  }
+};
+
+// The emulated EEPROM: `commit()` writes the whole image to "flash", which is
+// what a fresh image is loaded from after a reboot.
+class FakeImage {
+ public:
+  uint8_t data[image_size];
+  uint8_t committed[image_size];
+  uint8_t commits = 0;
+
+  uint8_t read(int index) {
+    return data[index];
+  }
+  void update(int index, uint8_t value) {
+    data[index] = value;
+  }
+  void commit() {
+    memcpy(committed, data, sizeof(data));
+    commits++;
+  }
+};
+
+typedef driver::storage::FlashLog<FakeFlash, FakeImage, image_size, log_size> Log;
+
+class TornRecord : public ::testing::Test {
+ protected:
+  uint8_t log_area_[log_size];
+  FakeFlash flash_;
+  FakeImage image_;
+
+  void SetUp() {
+    memset(log_area_, 0xff, sizeof(log_area_));
+    memset(image_.committed, 0, sizeof(image_.committed));
+    memcpy(image_.data, image_.committed, sizeof(image_.data));
+  }
+
+  // Writes `value` to every byte of `block` in the image, and logs it.
+  void store(Log &log, uint16_t block, uint8_t value) {
+    for (uint8_t i = 0; i < Log::block_size; i++)
+      image_.update(block * Log::block_size + i, value);
+    log.append(block);
+  }
+
+  // Loads the image from flash, as `Flash::begin()` does after a reboot.
+  void reboot() {
+    memcpy(image_.data, image_.committed, sizeof(image_.data));
+    image_.commits = 0;
+  }
+
+  void expectBlock(uint16_t block, uint8_t value) {
+    for (uint8_t i = 0; i < Log::block_size; i++)
+      EXPECT_EQ(image_.read(block * Log::block_size + i), value)
+          << "at offset " << int(block * Log::block_size + i);
+  }
+};
+
+TEST_F(TornRecord, RecordsAreReplayedAfterReboot) {
+  Log log(flash_, image_, log_area_);
+  log.replay();
+  store(log, 0, 0x11);
+  store(log, 2, 0x22);
+
+  reboot();
+  expectBlock(0, 0x00);
+
+  Log replayed(flash_, image_, log_area_);
+  EXPECT_FALSE(replayed.replay());
+  EXPECT_EQ(image_.commits, 0);
+  expectBlock(0, 0x11);
+  expectBlock(1, 0x00);
+  expectBlock(2, 0x22);
+}
+
+TEST_F(TornRecord, TornRecordIsCompacted) {
+  Log log(flash_, image_, log_area_);
+  log.replay();
+  store(log, 0, 0x11);
+
+  // The keyboard is reset halfway through writing the second record.
+  flash_.tear_after = sizeof(Log::Record) / 2;
+  store(log, 1, 0x22);
+  flash_.tear_after = -1;
+
+  reboot();
+  Log replayed(flash_, image_, log_area_);
+  EXPECT_TRUE(replayed.replay());
+  EXPECT_EQ(image_.commits, 1);
+  EXPECT_TRUE(replayed.empty());
+  expectBlock(0, 0x11);
+  expectBlock(1, 0x00);
+
+  // Changes made after the torn record was found must survive the next
+  // reboot, rather than being written over the remains of the torn record.
+  store(replayed, 1, 0x33);
+  store(replayed, 3, 0x44);
+
+  reboot();
+  Log after(flash_, image_, log_area_);
+  EXPECT_FALSE(after.replay());
+  expectBlock(0, 0x11);
+  expectBlock(1, 0x33);
+  expectBlock(3, 0x44);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
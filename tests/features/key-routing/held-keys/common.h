@@ -0,0 +1,46 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "kaleidoscope/key_defs.h"
+
+namespace kaleidoscope {
+namespace testing {
+
+// The keys each plugin of the sketch was called with, in order, split into
+// presses and releases, and keys that were held.
+struct SeenKeys {
+  std::vector<Key> toggled;
+  std::vector<Key> held;
+
+  void clear() {
+    toggled.clear();
+    held.clear();
+  }
+};
+
+// Sees no held keys at all.
+extern SeenKeys toggles_only;
+// Asks for every held key.
+extern SeenKeys all_held;
+// Only asks for `Key_A` while it is held.
+extern SeenKeys held_A;
+
+}  // namespace testing
+}  // namespace kaleidoscope
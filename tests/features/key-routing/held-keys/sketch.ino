@@ -0,0 +1,93 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define KALEIDOSCOPE_KEYSWITCH_TOGGLE_EVENTS_ONLY 1
+
+#include <Kaleidoscope.h>
+
+#include "./common.h"
+
+// *INDENT-OFF*
+KEYMAPS(
+  [0] = KEYMAP_STACKED
+  (
+      Key_A, Key_B, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+
+      ___, ___, ___, ___,
+      ___,
+
+      ___, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+           ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+
+      ___, ___, ___, ___,
+      ___
+   ),
+)
+// *INDENT-ON*
+
+namespace kaleidoscope {
+namespace testing {
+
+SeenKeys toggles_only;
+SeenKeys all_held;
+SeenKeys held_A;
+
+template <SeenKeys *_seen>
+class Recorder : public kaleidoscope::Plugin {
+ public:
+  EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
+    if (keyIsPressed(key_state) && keyWasPressed(key_state))
+      _seen->held.push_back(mapped_key);
+    else
+      _seen->toggled.push_back(mapped_key);
+    return EventHandlerResult::OK;
+  }
+};
+
+class TogglesOnly : public Recorder<&toggles_only> {};
+
+class AllHeld : public Recorder<&all_held> {
+ public:
+  typedef kaleidoscope::key_routing::AnyKey HeldKeys;
+};
+
+class HeldA : public Recorder<&held_A> {
+ public:
+  typedef kaleidoscope::key_routing::KeyRange<Key_A.getRaw(),
+                                              Key_A.getRaw()> HeldKeys;
+};
+
+}  // namespace testing
+}  // namespace kaleidoscope
+
+kaleidoscope::testing::TogglesOnly TogglesOnly;
+kaleidoscope::testing::AllHeld AllHeld;
+kaleidoscope::testing::HeldA HeldA;
+
+KALEIDOSCOPE_INIT_PLUGINS(TogglesOnly, AllHeld, HeldA);
+
+void setup() {
+  Kaleidoscope.setup();
+}
+
+void loop() {
+  Kaleidoscope.loop();
+}
@@ -0,0 +1,85 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/setup-googletest.h"
+
+#include "../common.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr KeyAddr addr_A{0, 0};
+constexpr KeyAddr addr_B{0, 1};
+
+typedef std::set<uint8_t> KeycodeSet;
+
+class HeldKeys : public VirtualDeviceTest {
+ protected:
+  // The keycodes in the last report sent so far.
+  KeycodeSet reported_;
+
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    toggles_only.clear();
+    all_held.clear();
+    held_A.clear();
+    reported_.clear();
+  }
+
+  void collect(const std::unique_ptr<State> &state) {
+    for (auto &report : state->HIDReports()->Keyboard()) {
+      auto keycodes = report.ActiveKeycodes();
+      reported_ = KeycodeSet(keycodes.begin(), keycodes.end());
+    }
+  }
+};
+
+TEST_F(HeldKeys, OnlyReachPluginsThatAskForThem) {
+  sim_.Press(addr_A);
+  sim_.Press(addr_B);
+  for (int i = 0; i < 5; i++)
+    collect(RunCycle());
+
+  // Both keys stay in the report while they are held, although not every
+  // plugin is called for them.
+  EXPECT_EQ(reported_, KeycodeSet({Key_A.getKeyCode(), Key_B.getKeyCode()}));
+
+  sim_.Release(addr_A);
+  sim_.Release(addr_B);
+  for (int i = 0; i < 2; i++)
+    collect(RunCycle());
+  EXPECT_THAT(reported_, ::testing::IsEmpty());
+
+  // Every plugin sees the keys being pressed and released.
+  for (auto seen : {&toggles_only, &all_held, &held_A}) {
+    EXPECT_THAT(seen->toggled,
+                ::testing::ElementsAre(Key_A, Key_B, Key_A, Key_B));
+  }
+
+  EXPECT_THAT(toggles_only.held, ::testing::IsEmpty());
+  EXPECT_THAT(all_held.held,
+              ::testing::ElementsAre(Key_A, Key_B, Key_A, Key_B,
+                                     Key_A, Key_B, Key_A, Key_B));
+  EXPECT_THAT(held_A.held,
+              ::testing::ElementsAre(Key_A, Key_A, Key_A, Key_A));
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,38 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "kaleidoscope/key_defs.h"
+
+namespace kaleidoscope {
+namespace testing {
+
+// The keys each plugin of the sketch was called with, as they were pressed.
+
+// Routed `Key_F13`, which is neither in the keymap, nor produced by a plugin.
+extern std::vector<Key> absent;
+// Routed `Key_F14`, which is in the keymap.
+extern std::vector<Key> in_keymap;
+// Routed `Key_F15`, which is not in the keymap, but another plugin produces.
+extern std::vector<Key> produced;
+// Sees every key.
+extern std::vector<Key> unrouted;
+
+}  // namespace testing
+}  // namespace kaleidoscope
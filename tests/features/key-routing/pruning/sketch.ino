@@ -0,0 +1,108 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define KALEIDOSCOPE_KEYMAP_PRUNING 1
+
+#include <Kaleidoscope.h>
+
+#include "./common.h"
+
+// *INDENT-OFF*
+KEYMAPS(
+  [0] = KEYMAP_STACKED
+  (
+      Key_F14, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+
+      ___, ___, ___, ___,
+      ___,
+
+      ___, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+           ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+
+      ___, ___, ___, ___,
+      ___
+   ),
+)
+// *INDENT-ON*
+
+namespace kaleidoscope {
+namespace testing {
+
+std::vector<Key> absent;
+std::vector<Key> in_keymap;
+std::vector<Key> produced;
+std::vector<Key> unrouted;
+
+template <std::vector<Key> *_seen>
+class Recorder : public kaleidoscope::Plugin {
+ public:
+  EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
+    if (keyToggledOn(key_state))
+      _seen->push_back(mapped_key);
+    return EventHandlerResult::OK;
+  }
+};
+
+class Absent : public Recorder<&absent> {
+ public:
+  typedef kaleidoscope::key_routing::KeyRange<Key_F13.getRaw(),
+                                              Key_F13.getRaw()> RoutedKeys;
+};
+
+class InKeymap : public Recorder<&in_keymap> {
+ public:
+  typedef kaleidoscope::key_routing::KeyRange<Key_F14.getRaw(),
+                                              Key_F14.getRaw()> RoutedKeys;
+};
+
+class Produced : public Recorder<&produced> {
+ public:
+  typedef kaleidoscope::key_routing::KeyRange<Key_F15.getRaw(),
+                                              Key_F15.getRaw()> RoutedKeys;
+};
+
+class Unrouted : public Recorder<&unrouted> {};
+
+// Stands for a plugin that injects `Key_F15` from its own configuration.
+class Producer : public kaleidoscope::Plugin {
+ public:
+  typedef kaleidoscope::key_routing::KeyRange<Key_F15.getRaw(),
+                                              Key_F15.getRaw()> ProducedKeys;
+};
+
+}  // namespace testing
+}  // namespace kaleidoscope
+
+kaleidoscope::testing::Absent Absent;
+kaleidoscope::testing::InKeymap InKeymap;
+kaleidoscope::testing::Produced Produced;
+kaleidoscope::testing::Unrouted Unrouted;
+kaleidoscope::testing::Producer Producer;
+
+KALEIDOSCOPE_INIT_PLUGINS(Absent, InKeymap, Produced, Unrouted, Producer);
+
+void setup() {
+  Kaleidoscope.setup();
+}
+
+void loop() {
+  Kaleidoscope.loop();
+}
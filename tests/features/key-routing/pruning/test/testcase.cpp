@@ -0,0 +1,70 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/setup-googletest.h"
+
+#include "../common.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+class KeymapPruning : public VirtualDeviceTest {
+ protected:
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    for (auto seen : {&absent, &in_keymap, &produced, &unrouted})
+      seen->clear();
+  }
+
+  void tap(Key key) {
+    handleKeyswitchEvent(key, UnknownKeyswitchLocation, IS_PRESSED | INJECTED);
+    handleKeyswitchEvent(key, UnknownKeyswitchLocation, WAS_PRESSED | INJECTED);
+  }
+};
+
+TEST_F(KeymapPruning, UnreachablePluginsAreSkipped) {
+  tap(Key_F13);
+  tap(Key_F14);
+  tap(Key_F15);
+
+  EXPECT_THAT(unrouted, ::testing::ElementsAre(Key_F13, Key_F14, Key_F15));
+
+  // Nothing could produce `Key_F13`, so its plugin was left out.
+  EXPECT_THAT(absent, ::testing::IsEmpty());
+}
+
+TEST_F(KeymapPruning, PluginsWithKeysInTheKeymapAreKept) {
+  tap(Key_F14);
+  EXPECT_THAT(in_keymap, ::testing::ElementsAre(Key_F14));
+
+  sim_.Press(0, 0); // F14
+  RunCycle();
+  sim_.Release(0, 0); // F14
+  RunCycle();
+  EXPECT_THAT(in_keymap, ::testing::ElementsAre(Key_F14, Key_F14));
+}
+
+TEST_F(KeymapPruning, PluginsWithProducedKeysAreKept) {
+  tap(Key_F15);
+  EXPECT_THAT(produced, ::testing::ElementsAre(Key_F15));
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,98 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Kaleidoscope.h>
+#include <Kaleidoscope-Macros.h>
+
+#include "./common.h"
+
+// *INDENT-OFF*
+KEYMAPS(
+  [0] = KEYMAP_STACKED
+  (
+      Key_X, M(1), Key_Z, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+
+      ___, ___, ___, ___,
+      ___,
+
+      ___, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+           ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+
+      ___, ___, ___, ___,
+      ___
+   ),
+)
+// *INDENT-ON*
+
+const macro_t *macroAction(uint8_t index, uint8_t keyState) {
+  switch (index) {
+  case 0:
+    return MACRODOWN(T(A));
+  case 1:
+    return MACRODOWN(T(B));
+  }
+  return MACRO_NONE;
+}
+
+namespace kaleidoscope {
+namespace testing {
+
+std::vector<Key> routed_keys;
+
+// Turns `Key_X` into a macro key, and the `M(1)` macro key into `Key_Y`.
+class Rewrite : public kaleidoscope::Plugin {
+ public:
+  EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
+    if (mapped_key == Key_X)
+      mapped_key = M(0);
+    else if (mapped_key == M(1))
+      mapped_key = Key_Y;
+    return EventHandlerResult::OK;
+  }
+};
+
+// Routed to the same keys as Macros, and records the ones it gets.
+class MacroRange : public kaleidoscope::Plugin {
+ public:
+  typedef kaleidoscope::key_routing::KeyRange<ranges::MACRO_FIRST,
+                                              ranges::MACRO_LAST> RoutedKeys;
+
+  EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
+    routed_keys.push_back(mapped_key);
+    return EventHandlerResult::OK;
+  }
+};
+
+}  // namespace testing
+}  // namespace kaleidoscope
+
+kaleidoscope::testing::Rewrite Rewrite;
+kaleidoscope::testing::MacroRange MacroRange;
+
+KALEIDOSCOPE_INIT_PLUGINS(Rewrite, MacroRange, Macros);
+
+void setup() {
+  Kaleidoscope.setup();
+}
+
+void loop() {
+  Kaleidoscope.loop();
+}
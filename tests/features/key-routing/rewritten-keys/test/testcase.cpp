@@ -0,0 +1,99 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kaleidoscope-Macros.h"
+
+#include "testing/setup-googletest.h"
+
+#include "../common.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr KeyAddr addr_X{0, 0};
+constexpr KeyAddr addr_M1{0, 1};
+constexpr KeyAddr addr_Z{0, 2};
+
+class RewrittenKeys : public VirtualDeviceTest {
+ protected:
+  // The keycodes each report added, in order.
+  std::vector<uint8_t> added_;
+  std::set<uint8_t> held_;
+
+  void collect(const std::unique_ptr<State> &state) {
+    for (auto &report : state->HIDReports()->Keyboard()) {
+      std::set<uint8_t> now;
+      for (uint8_t keycode : report.ActiveKeycodes()) {
+        now.insert(keycode);
+        if (held_.count(keycode) == 0)
+          added_.push_back(keycode);
+      }
+      held_ = now;
+    }
+  }
+
+  void tap(KeyAddr key_addr) {
+    sim_.Press(key_addr);
+    collect(RunCycle());
+    collect(RunCycle());
+    sim_.Release(key_addr);
+    for (int i = 0; i < 4; i++)
+      collect(RunCycle());
+  }
+
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    routed_keys.clear();
+  }
+};
+
+TEST_F(RewrittenKeys, RoutedPluginGetsKeysRewrittenIntoItsRange) {
+  tap(addr_X);
+
+  // The key is routed after `Rewrite` turned it into a macro key: when it is
+  // pressed, on the next cycle while it is held, and when it is released.
+  EXPECT_EQ(routed_keys.size(), 3);
+  for (Key key : routed_keys)
+    EXPECT_EQ(key, M(0));
+
+  // And Macros got it too.
+  EXPECT_THAT(added_, ::testing::ElementsAre(Key_A.getKeyCode()));
+  EXPECT_THAT(held_, ::testing::IsEmpty());
+}
+
+TEST_F(RewrittenKeys, RoutedPluginSkipsKeysRewrittenOutOfItsRange) {
+  tap(addr_M1);
+
+  // The macro key in the keymap is no longer one by the time it's routed.
+  EXPECT_THAT(routed_keys, ::testing::IsEmpty());
+  EXPECT_THAT(added_, ::testing::ElementsAre(Key_Y.getKeyCode()));
+  EXPECT_THAT(held_, ::testing::IsEmpty());
+}
+
+TEST_F(RewrittenKeys, RoutedPluginSkipsOtherKeys) {
+  tap(addr_Z);
+
+  EXPECT_THAT(routed_keys, ::testing::IsEmpty());
+  EXPECT_THAT(added_, ::testing::ElementsAre(Key_Z.getKeyCode()));
+  EXPECT_THAT(held_, ::testing::IsEmpty());
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
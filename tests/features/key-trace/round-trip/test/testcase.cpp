@@ -0,0 +1,140 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kaleidoscope-KeyTrace.h"
+#include "kaleidoscope/key_trace.h"
+#include "testing/Benchmark.h"
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+// Collects what the KeyTrace plugin writes.
+class TraceBuffer : public Print {
+ public:
+  size_t write(uint8_t byte) {
+    data.push_back(byte);
+    return 1;
+  }
+
+  std::vector<uint8_t> data;
+};
+
+class KeyTraceRoundTrip : public VirtualDeviceTest {
+ public:
+  const KeyAddr KEYSWITCH_A = KeyAddr{0, 1};
+  const KeyAddr KEYSWITCH_B = KeyAddr{0, 2};
+
+  // The events recorded, with their times since recording started.
+  std::vector<TraceEvent> events_;
+
+  void toggle(KeyAddr key_addr, bool pressed, uint32_t start) {
+    if (pressed)
+      sim_.Press(key_addr);
+    else
+      sim_.Release(key_addr);
+    RunCycle();
+    events_.push_back({Kaleidoscope.millisAtCycleStart() - start, key_addr, pressed});
+  }
+
+  // Taps A, then B after a pause longer than a single record can hold, with
+  // the KeyTrace plugin recording.
+  std::vector<uint8_t> record() {
+    TraceBuffer buffer;
+
+    ClearState();
+    events_.clear();
+    uint32_t start = Kaleidoscope.millisAtCycleStart();
+    KeyTrace.start(buffer);
+
+    sim_.RunForMillis(5);
+    toggle(KEYSWITCH_A, true, start);
+    sim_.RunForMillis(10);
+    toggle(KEYSWITCH_A, false, start);
+
+    sim_.SetCycleTime(250);
+    sim_.RunForMillis(40000);
+    sim_.SetCycleTime(1);
+
+    toggle(KEYSWITCH_B, true, start);
+    sim_.RunForMillis(5);
+    toggle(KEYSWITCH_B, false, start);
+
+    KeyTrace.stop();
+    return buffer.data;
+  }
+};
+
+TEST_F(KeyTraceRoundTrip, DecodesWhatWasRecorded) {
+  auto trace = record();
+
+  // The pause took an extra record.
+  EXPECT_EQ(trace.size(), key_trace::header_size + 5 * key_trace::record_size);
+
+  auto decoded = Benchmark::ReadTrace(trace.data(), trace.size());
+  ASSERT_EQ(decoded.size(), events_.size());
+  for (size_t i = 0; i < decoded.size(); i++) {
+    EXPECT_EQ(decoded[i].time, events_[i].time) << "event " << i;
+    EXPECT_EQ(decoded[i].key_addr, events_[i].key_addr) << "event " << i;
+    EXPECT_EQ(decoded[i].pressed, events_[i].pressed) << "event " << i;
+  }
+}
+
+TEST_F(KeyTraceRoundTrip, ReplaysThroughTheScanner) {
+  auto trace = record();
+  auto &scanner = Kaleidoscope.device().keyScanner();
+
+  ClearState();
+  ASSERT_TRUE(scanner.replayTrace(trace.data(), trace.size()));
+
+  std::vector<std::pair<uint32_t, std::vector<uint8_t>>> reports;
+  scanner.setEnableReadMatrix(true);
+  while (scanner.replayingTrace()) {
+    auto state = RunCycle();
+    for (auto &report : state->HIDReports()->Keyboard())
+      reports.push_back({report.Timestamp(), report.ActiveKeycodes()});
+  }
+  scanner.setEnableReadMatrix(false);
+
+  ASSERT_EQ(reports.size(), 4);
+  EXPECT_THAT(reports[0].second, Contains(Key_A));
+  EXPECT_THAT(reports[1].second, ::testing::IsEmpty());
+  EXPECT_THAT(reports[2].second, Contains(Key_B));
+  EXPECT_THAT(reports[3].second, ::testing::IsEmpty());
+
+  // The replay keeps the spacing of the recorded events.
+  for (size_t i = 1; i < reports.size(); i++) {
+    EXPECT_EQ(reports[i].first - reports[i - 1].first,
+              events_[i].time - events_[i - 1].time) << "report " << i;
+  }
+}
+
+TEST_F(KeyTraceRoundTrip, RefusesTracesOfOtherDevices) {
+  auto trace = record();
+  trace[3] = KeyAddr::upper_limit - 1;
+
+  EXPECT_FALSE(Kaleidoscope.device().keyScanner().replayTrace(trace.data(), trace.size()));
+  EXPECT_FALSE(Kaleidoscope.device().keyScanner().replayingTrace());
+  EXPECT_TRUE(Benchmark::ReadTrace(trace.data(), trace.size()).empty());
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,190 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+// When set, replaces the top left key of layer 2 (transparent in the sketch).
+Key layer2_override = Key_Transparent;
+
+Key getKeyWithOverride(uint8_t layer, KeyAddr key_addr) {
+  if (layer == 2 && key_addr == KeyAddr{0, 0})
+    return layer2_override;
+  return Layer_::getKeyFromPROGMEM(layer, key_addr);
+}
+
+class LayerIncrementalCache : public VirtualDeviceTest {
+ public:
+  const KeyAddr KEYSWITCH_LAYERED = KeyAddr{0, 0};  // 0 / 1 / ___
+  const KeyAddr KEYSWITCH_OTHER = KeyAddr{0, 1};    // A / ___ / B
+  const KeyAddr KEYSWITCH_LOCK_1 = KeyAddr{0, 2};   // LockLayer(1)
+  const KeyAddr KEYSWITCH_LOCK_2 = KeyAddr{0, 3};   // LockLayer(2)
+  const KeyAddr KEYSWITCH_MOVE_2 = KeyAddr{0, 4};   // MoveToLayer(2)
+  const KeyAddr KEYSWITCH_MOVE_0 = KeyAddr{0, 5};   // MoveToLayer(0), layer 2 only
+
+  void tapKeyswitch(const KeyAddr& addr) {
+    sim_.Press(addr.row(), addr.col());
+    RunCycle();
+    sim_.Release(addr.row(), addr.col());
+    RunCycle();
+  }
+
+  // Checks both the active layer cache and the key a press actually sends.
+  void expectKey(const KeyAddr& addr, Key k, uint8_t layer) {
+    EXPECT_EQ(Layer.lookupActiveLayer(addr), layer);
+    EXPECT_EQ(Layer.lookupOnActiveLayer(addr), k);
+
+    sim_.Press(addr.row(), addr.col());
+    auto state = RunCycle();
+    ASSERT_EQ(state->HIDReports()->Keyboard().size(), 1);
+    EXPECT_THAT(
+      state->HIDReports()->Keyboard(0).ActiveKeycodes(),
+      Contains(k));
+
+    sim_.Release(addr.row(), addr.col());
+    state = RunCycle();
+    ASSERT_EQ(state->HIDReports()->Keyboard().size(), 1);
+    EXPECT_THAT(
+      state->HIDReports()->Keyboard(0).ActiveKeycodes(),
+      ::testing::IsEmpty());
+  }
+
+  // Every test leaves the keyboard on layer 0 alone, as it found it.
+  void backToLayerZero() {
+    tapKeyswitch(KEYSWITCH_MOVE_0);
+    EXPECT_TRUE(Layer.isActive(0));
+    EXPECT_FALSE(Layer.isActive(1));
+    EXPECT_FALSE(Layer.isActive(2));
+    expectKey(KEYSWITCH_LAYERED, Key_0, 0);
+    expectKey(KEYSWITCH_OTHER, Key_A, 0);
+  }
+};
+
+TEST_F(LayerIncrementalCache, DeactivateLayerBelowTheTop) {
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+  tapKeyswitch(KEYSWITCH_LOCK_2);
+  ASSERT_TRUE(Layer.isActive(1));
+  ASSERT_TRUE(Layer.isActive(2));
+
+  // Layer 2 is transparent over the layered key, so layer 1 shows through.
+  expectKey(KEYSWITCH_LAYERED, Key_1, 1);
+  expectKey(KEYSWITCH_OTHER, Key_B, 2);
+
+  // Turning layer 1 off, while layer 2 stays on top of it, must re-resolve
+  // the keys that came from layer 1, and only those.
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+  EXPECT_FALSE(Layer.isActive(1));
+  EXPECT_TRUE(Layer.isActive(2));
+  EXPECT_EQ(Layer.mostRecent(), 2);
+  expectKey(KEYSWITCH_LAYERED, Key_0, 0);
+  expectKey(KEYSWITCH_OTHER, Key_B, 2);
+
+  // Layer 1 comes back on top of layer 2 now, but is itself transparent over
+  // the other key.
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+  EXPECT_EQ(Layer.mostRecent(), 1);
+  expectKey(KEYSWITCH_LAYERED, Key_1, 1);
+  expectKey(KEYSWITCH_OTHER, Key_B, 2);
+
+  // And turning layer 2 off from below layer 1 leaves the layered key alone.
+  tapKeyswitch(KEYSWITCH_LOCK_2);
+  EXPECT_FALSE(Layer.isActive(2));
+  EXPECT_EQ(Layer.mostRecent(), 1);
+  expectKey(KEYSWITCH_LAYERED, Key_1, 1);
+  expectKey(KEYSWITCH_OTHER, Key_A, 0);
+
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+  EXPECT_EQ(Layer.mostRecent(), 0);
+  expectKey(KEYSWITCH_LAYERED, Key_0, 0);
+  expectKey(KEYSWITCH_OTHER, Key_A, 0);
+}
+
+TEST_F(LayerIncrementalCache, DeactivateLayerZero) {
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+
+  // Layer 0 is at the bottom of the stack; turning it off must remove it, not
+  // the layer on top.
+  Layer.deactivate(0);
+  EXPECT_FALSE(Layer.isActive(0));
+  EXPECT_TRUE(Layer.isActive(1));
+  EXPECT_EQ(Layer.mostRecent(), 1);
+  expectKey(KEYSWITCH_LAYERED, Key_1, 1);
+  expectKey(KEYSWITCH_OTHER, Key_A, 0);
+
+  Layer.activate(0);
+  EXPECT_EQ(Layer.mostRecent(), 0);
+  expectKey(KEYSWITCH_LAYERED, Key_0, 0);
+
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+  EXPECT_FALSE(Layer.isActive(1));
+  EXPECT_EQ(Layer.mostRecent(), 0);
+  expectKey(KEYSWITCH_LAYERED, Key_0, 0);
+  expectKey(KEYSWITCH_OTHER, Key_A, 0);
+}
+
+TEST_F(LayerIncrementalCache, Move) {
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+  ASSERT_TRUE(Layer.isActive(1));
+
+  // Moving to layer 2 leaves it as the only active layer; its transparent
+  // keys fall back to layer 0, not to layer 1.
+  tapKeyswitch(KEYSWITCH_MOVE_2);
+  EXPECT_FALSE(Layer.isActive(0));
+  EXPECT_FALSE(Layer.isActive(1));
+  EXPECT_TRUE(Layer.isActive(2));
+  EXPECT_EQ(Layer.mostRecent(), 2);
+  expectKey(KEYSWITCH_LAYERED, Key_0, 0);
+  expectKey(KEYSWITCH_OTHER, Key_B, 2);
+
+  backToLayerZero();
+}
+
+TEST_F(LayerIncrementalCache, KeymapChange) {
+  layer2_override = Key_Transparent;
+  Layer.getKey = &getKeyWithOverride;
+  Layer.updateActiveLayers();
+
+  tapKeyswitch(KEYSWITCH_LOCK_2);
+  ASSERT_TRUE(Layer.isActive(2));
+  expectKey(KEYSWITCH_LAYERED, Key_0, 0);
+
+  // Changing the keymap under the same `getKey` is not noticed until
+  // `updateActiveLayers()` is called.
+  layer2_override = Key_C;
+  Layer.updateActiveLayers();
+  expectKey(KEYSWITCH_LAYERED, Key_C, 2);
+  expectKey(KEYSWITCH_OTHER, Key_B, 2);
+
+  // And the rebuilt cache is the one later layer changes start from.
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+  expectKey(KEYSWITCH_LAYERED, Key_1, 1);
+  tapKeyswitch(KEYSWITCH_LOCK_1);
+  expectKey(KEYSWITCH_LAYERED, Key_C, 2);
+
+  layer2_override = Key_Transparent;
+  Layer.getKey = &Layer_::getKeyFromPROGMEM;
+  backToLayerZero();
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
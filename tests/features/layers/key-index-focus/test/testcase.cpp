@@ -0,0 +1,126 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/setup-googletest.h"
+#include "Kaleidoscope-EEPROM-Keymap.h"
+#include "Kaleidoscope-FocusSerial.h"
+
+#include <string>
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr KeyAddr addr_A{0, 0};      // A
+constexpr KeyAddr addr_shift{0, 1};  // LeftShift
+
+// The keymap in storage is layer 1, above the one in PROGMEM.
+constexpr uint8_t storage_layer = 1;
+
+KeyIndex modifiers(Key_LeftControl, Key_RightGui);
+
+// A stream that reads from a string.
+class StringStream : public Stream {
+ public:
+  explicit StringStream(const std::string &data) : data_(data) {}
+
+  int available() {
+    return data_.size() - pos_;
+  }
+  int read() {
+    return pos_ < data_.size() ? data_[pos_++] : -1;
+  }
+  int peek() {
+    return pos_ < data_.size() ? data_[pos_] : -1;
+  }
+  size_t write(uint8_t) {
+    return 1;
+  }
+  void flush() {}
+
+ private:
+  std::string data_;
+  size_t pos_ = 0;
+};
+
+class KeyIndexFocus : public VirtualDeviceTest {
+ protected:
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    Layer.addKeyIndex(modifiers);
+  }
+
+  // Sends the whole storage back with `eeprom.contents`, as a host restoring a
+  // backup would, with the keymap in storage holding `first` and `second` on
+  // the first two keys, and transparent keys everywhere else.
+  void writeKeymap(Key first, Key second) {
+    std::vector<uint8_t> contents;
+    for (uint16_t i = 0; i < Runtime.storage().length(); i++)
+      contents.push_back(Runtime.storage().read(i));
+
+    uint16_t base = ::EEPROMKeymap.keymap_base();
+    for (auto key_addr : KeyAddr::all()) {
+      Key key = Key_Transparent;
+      if (key_addr == addr_A)
+        key = first;
+      else if (key_addr == addr_shift)
+        key = second;
+      contents[base + key_addr.toInt() * 2] = key.getFlags();
+      contents[base + key_addr.toInt() * 2 + 1] = key.getKeyCode();
+    }
+
+    std::string text;
+    for (uint8_t byte : contents) {
+      if (!text.empty())
+        text += ' ';
+      text += std::to_string(byte);
+    }
+    text += '\n';
+
+    StringStream stream(text);
+    ::Focus.dispatch("eeprom.contents", stream);
+  }
+
+  // The addresses the index yields when iterated over.
+  std::vector<uint8_t> indexed() {
+    std::vector<uint8_t> addrs;
+    for (auto key_addr : modifiers)
+      addrs.push_back(key_addr.toInt());
+    return addrs;
+  }
+};
+
+TEST_F(KeyIndexFocus, FollowsKeymapWrittenOverFocus) {
+  EXPECT_THAT(indexed(), ::testing::ElementsAre(addr_shift.toInt()));
+
+  Layer.activate(storage_layer);
+  writeKeymap(Key_LeftControl, Key_B);
+  EXPECT_EQ(Layer.lookupOnActiveLayer(addr_A), Key_LeftControl);
+  EXPECT_THAT(indexed(), ::testing::ElementsAre(addr_A.toInt()));
+
+  // With the storage layer transparent, the PROGMEM layer shows through again.
+  writeKeymap(Key_Transparent, Key_Transparent);
+  EXPECT_EQ(Layer.lookupOnActiveLayer(addr_A), Key_A);
+  EXPECT_THAT(indexed(), ::testing::ElementsAre(addr_shift.toInt()));
+
+  Layer.deactivate(storage_layer);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,105 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr KeyAddr addr_shift{0, 0};         // LeftShift / X
+constexpr KeyAddr addr_A{0, 1};             // A / LeftShift
+constexpr KeyAddr addr_layer_key{0, 2};     // ShiftToLayer(1) / ___
+constexpr KeyAddr addr_B{0, 3};             // B / LeftControl
+
+KeyIndex modifiers(Key_LeftControl, Key_RightGui);
+// A key that is on no layer.
+KeyIndex absent(Key_F24);
+
+class LayerKeyIndex : public VirtualDeviceTest {
+ protected:
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    Layer.addKeyIndex(modifiers);
+    Layer.addKeyIndex(absent);
+  }
+
+  // The addresses the index yields when iterated over.
+  std::vector<uint8_t> indexed() {
+    std::vector<uint8_t> addrs;
+    for (auto key_addr : modifiers)
+      addrs.push_back(key_addr.toInt());
+    return addrs;
+  }
+
+  // Checks the index against a lookup of every key.
+  void expectIndexMatchesKeymap() {
+    for (auto key_addr : KeyAddr::all()) {
+      Key key = Layer.lookupOnActiveLayer(key_addr);
+      bool is_modifier = key >= Key_LeftControl && key <= Key_RightGui;
+      EXPECT_EQ(modifiers.has(key_addr), is_modifier)
+          << "for key address " << int(key_addr.toInt());
+    }
+  }
+};
+
+TEST_F(LayerKeyIndex, FollowsLayerKey) {
+  EXPECT_TRUE(modifiers.has(addr_shift));
+  EXPECT_FALSE(modifiers.has(addr_A));
+  EXPECT_THAT(indexed(), ::testing::ElementsAre(addr_shift.toInt()));
+  expectIndexMatchesKeymap();
+
+  // Layer 1 moves the shift, and adds a control.
+  sim_.Press(addr_layer_key);
+  RunCycle();
+  EXPECT_FALSE(modifiers.has(addr_shift));
+  EXPECT_TRUE(modifiers.has(addr_A));
+  EXPECT_TRUE(modifiers.has(addr_B));
+  EXPECT_THAT(indexed(), ::testing::ElementsAre(addr_A.toInt(), addr_B.toInt()));
+  expectIndexMatchesKeymap();
+
+  sim_.Release(addr_layer_key);
+  RunCycle();
+  EXPECT_TRUE(modifiers.has(addr_shift));
+  EXPECT_FALSE(modifiers.has(addr_A));
+  EXPECT_FALSE(modifiers.has(addr_B));
+  EXPECT_THAT(indexed(), ::testing::ElementsAre(addr_shift.toInt()));
+  expectIndexMatchesKeymap();
+}
+
+TEST_F(LayerKeyIndex, FollowsLayerMoves) {
+  Layer.move(1);
+  EXPECT_THAT(indexed(), ::testing::ElementsAre(addr_A.toInt(), addr_B.toInt()));
+  expectIndexMatchesKeymap();
+
+  Layer.move(0);
+  EXPECT_THAT(indexed(), ::testing::ElementsAre(addr_shift.toInt()));
+  expectIndexMatchesKeymap();
+}
+
+TEST_F(LayerKeyIndex, EmptyIndexYieldsNothing) {
+  Layer.move(1);
+  EXPECT_FALSE(absent.begin() != absent.end());
+  for (auto key_addr : KeyAddr::all())
+    EXPECT_FALSE(absent.has(key_addr));
+  Layer.move(0);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
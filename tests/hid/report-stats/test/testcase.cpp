@@ -0,0 +1,78 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+class ReportStats : public VirtualDeviceTest {
+ protected:
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    Runtime.hid().keyboard().resetReportStats();
+  }
+
+  const auto &stats() {
+    return Runtime.hid().keyboard().reportStats();
+  }
+};
+
+// The HID library refuses to send a report that is the same as its last one.
+// An idle keyboard must not count that as a failure, nor keep retrying it.
+TEST_F(ReportStats, IdleCyclesSendNothing) {
+  sim_.RunCycles(10);
+
+  EXPECT_EQ(stats().sent, 0);
+  EXPECT_EQ(stats().failed, 0);
+}
+
+TEST_F(ReportStats, ChangedReportsAreSentOnce) {
+  sim_.Press(0, 0); // A
+  sim_.RunCycles(5);
+
+  EXPECT_EQ(stats().sent, 1);
+
+  sim_.Release(0, 0); // A
+  sim_.RunCycles(5);
+
+  EXPECT_EQ(stats().sent, 2);
+  EXPECT_EQ(stats().failed, 0);
+}
+
+TEST_F(ReportStats, ProtocolSwitchDoesNotFail) {
+  Runtime.hid().keyboard().setProtocol(HID_BOOT_PROTOCOL);
+  sim_.RunCycles(5);
+  Runtime.hid().keyboard().setProtocol(HID_REPORT_PROTOCOL);
+  sim_.RunCycles(5);
+
+  EXPECT_LE(stats().sent, 2);
+  EXPECT_EQ(stats().failed, 0);
+
+  sim_.Press(0, 0); // A
+  sim_.RunCycles(5);
+  sim_.Release(0, 0); // A
+  sim_.RunCycles(5);
+
+  EXPECT_EQ(stats().failed, 0);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,183 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kaleidoscope-DynamicMacros.h"
+#include "Kaleidoscope-FocusSerial.h"
+
+#include "testing/setup-googletest.h"
+
+#include <string>
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr KeyAddr addr_DM0{0, 0};
+constexpr KeyAddr addr_DM1{0, 1};
+constexpr KeyAddr addr_DM2{0, 2};
+
+typedef std::set<uint8_t> KeycodeSet;
+
+// A stream that reads from a string.
+class StringStream : public Stream {
+ public:
+  explicit StringStream(const std::string &data) : data_(data) {}
+
+  int available() {
+    return data_.size() - pos_;
+  }
+  int read() {
+    return pos_ < data_.size() ? data_[pos_++] : -1;
+  }
+  int peek() {
+    return pos_ < data_.size() ? data_[pos_] : -1;
+  }
+  size_t write(uint8_t) {
+    return 1;
+  }
+  void flush() {}
+
+ private:
+  std::string data_;
+  size_t pos_ = 0;
+};
+
+class DynamicMacrosPlayback : public VirtualDeviceTest {
+ protected:
+  // The keycodes of every report sent, and when they were sent.
+  std::vector<KeycodeSet> reports_;
+  std::vector<uint32_t> timestamps_;
+
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    reports_.clear();
+    timestamps_.clear();
+  }
+
+  // Stores `macros` with the `macros.map` command, as the host does.
+  void writeMacros(const std::vector<uint8_t> &macros) {
+    std::string text;
+    for (uint8_t byte : macros) {
+      if (!text.empty())
+        text += ' ';
+      text += std::to_string(byte);
+    }
+    text += '\n';
+
+    StringStream stream(text);
+    ::Focus.dispatch("macros.map", stream);
+  }
+
+  void collect(const std::unique_ptr<State> &state) {
+    for (auto &report : state->HIDReports()->Keyboard()) {
+      auto keycodes = report.ActiveKeycodes();
+      reports_.push_back(KeycodeSet(keycodes.begin(), keycodes.end()));
+      timestamps_.push_back(report.Timestamp());
+    }
+  }
+
+  // Taps the macro key, and runs cycles until the macro is done playing.
+  void play(KeyAddr key_addr) {
+    sim_.Press(key_addr);
+    collect(RunCycle());
+    sim_.Release(key_addr);
+    for (int cycles = 0; ::DynamicMacros.isPlaying() && cycles < 1000; cycles++)
+      collect(RunCycle());
+  }
+};
+
+std::vector<uint8_t> tapsAndWaits() {
+  return {
+    // DM(0)
+    MACRO_ACTION_STEP_TAPCODE, Key_A.getKeyCode(),
+    MACRO_ACTION_STEP_TAPCODE, Key_B.getKeyCode(),
+    MACRO_ACTION_END,
+    // DM(1): the low byte of the wait looks like the end of a macro.
+    MACRO_ACTION_STEP_TAPCODE, Key_C.getKeyCode(),
+    MACRO_ACTION_STEP_WAIT, 0x01, 0x00,
+    MACRO_ACTION_STEP_TAPCODE, Key_D.getKeyCode(),
+    MACRO_ACTION_END,
+    // DM(2)
+    MACRO_ACTION_STEP_TAPCODE, Key_E.getKeyCode(),
+    MACRO_ACTION_END,
+    MACRO_ACTION_END,
+  };
+}
+
+TEST_F(DynamicMacrosPlayback, PlaysMacrosWrittenOverFocus) {
+  writeMacros(tapsAndWaits());
+
+  play(addr_DM0);
+  uint8_t a = Key_A.getKeyCode();
+  uint8_t b = Key_B.getKeyCode();
+  EXPECT_THAT(reports_, ::testing::ElementsAre(KeycodeSet{a}, KeycodeSet{},
+                                               KeycodeSet{b}, KeycodeSet{}));
+
+  reports_.clear();
+  play(addr_DM2);
+  uint8_t e = Key_E.getKeyCode();
+  EXPECT_THAT(reports_, ::testing::ElementsAre(KeycodeSet{e}, KeycodeSet{}));
+}
+
+TEST_F(DynamicMacrosPlayback, WaitsAreTimers) {
+  writeMacros(tapsAndWaits());
+
+  play(addr_DM1);
+  uint8_t c = Key_C.getKeyCode();
+  uint8_t d = Key_D.getKeyCode();
+  ASSERT_THAT(reports_, ::testing::ElementsAre(KeycodeSet{c}, KeycodeSet{},
+                                               KeycodeSet{d}, KeycodeSet{}));
+
+  // The cycles keep running while the macro waits.
+  EXPECT_GE(timestamps_[2] - timestamps_[1], 0x100);
+  EXPECT_LE(timestamps_[2] - timestamps_[1], 0x100 + 2 * sim_.CycleTime());
+}
+
+TEST_F(DynamicMacrosPlayback, RewritingTheMacrosClearsTheCache) {
+  writeMacros(tapsAndWaits());
+  play(addr_DM0);
+  play(addr_DM2);
+
+  // Both macros are now cached, decoded. Replace them with ones of different
+  // lengths.
+  writeMacros({
+    MACRO_ACTION_STEP_TAPCODE, Key_F.getKeyCode(),
+    MACRO_ACTION_END,
+    MACRO_ACTION_END,
+    MACRO_ACTION_STEP_TAPCODE, Key_G.getKeyCode(),
+    MACRO_ACTION_STEP_TAPCODE, Key_H.getKeyCode(),
+    MACRO_ACTION_END,
+    MACRO_ACTION_END,
+  });
+
+  reports_.clear();
+  play(addr_DM0);
+  uint8_t f = Key_F.getKeyCode();
+  EXPECT_THAT(reports_, ::testing::ElementsAre(KeycodeSet{f}, KeycodeSet{}));
+
+  reports_.clear();
+  play(addr_DM2);
+  uint8_t g = Key_G.getKeyCode();
+  uint8_t h = Key_H.getKeyCode();
+  EXPECT_THAT(reports_, ::testing::ElementsAre(KeycodeSet{g}, KeycodeSet{},
+                                               KeycodeSet{h}, KeycodeSet{}));
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
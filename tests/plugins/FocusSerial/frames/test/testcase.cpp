@@ -0,0 +1,151 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kaleidoscope-FocusSerial.h"
+#include "kaleidoscope/util/crc16.h"
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+// Where the tests store frames, and how much they may store there.
+constexpr uint16_t storage_base = 512;
+constexpr uint16_t max_length = 32;
+
+// A stream that reads from a byte string.
+class BufferStream : public Stream {
+ public:
+  explicit BufferStream(const std::vector<uint8_t> &data) : data_(data) {}
+
+  int available() {
+    return data_.size() - pos_;
+  }
+  int read() {
+    return pos_ < data_.size() ? data_[pos_++] : -1;
+  }
+  int peek() {
+    return pos_ < data_.size() ? data_[pos_] : -1;
+  }
+  size_t write(uint8_t) {
+    return 1;
+  }
+  void flush() {}
+
+ private:
+  std::vector<uint8_t> data_;
+  size_t pos_ = 0;
+};
+
+class FocusFrames : public VirtualDeviceTest {
+ protected:
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    for (uint16_t i = 0; i < max_length; i++)
+      Runtime.storage().update(storage_base + i, 0xa0 + i);
+    Runtime.storage().commit();
+  }
+
+  std::vector<uint8_t> stored() {
+    std::vector<uint8_t> bytes;
+    for (uint16_t i = 0; i < max_length; i++)
+      bytes.push_back(Runtime.storage().read(storage_base + i));
+    return bytes;
+  }
+
+  std::vector<uint8_t> untouched() {
+    std::vector<uint8_t> bytes;
+    for (uint16_t i = 0; i < max_length; i++)
+      bytes.push_back(0xa0 + i);
+    return bytes;
+  }
+
+  // A frame, as the host sends it.
+  std::vector<uint8_t> frame(uint16_t offset, const std::vector<uint8_t> &payload) {
+    uint16_t length = payload.size();
+    std::vector<uint8_t> data = {
+      static_cast<uint8_t>(plugin::FocusSerial::FRAME_START),
+      static_cast<uint8_t>(offset & 0xff), static_cast<uint8_t>(offset >> 8),
+      static_cast<uint8_t>(length & 0xff), static_cast<uint8_t>(length >> 8),
+    };
+    data.insert(data.end(), payload.begin(), payload.end());
+
+    uint16_t crc = 0xffff;
+    for (size_t i = 1; i < data.size(); i++)
+      crc = _crc_ccitt_update(crc, data[i]);
+    data.push_back(crc & 0xff);
+    data.push_back(crc >> 8);
+    return data;
+  }
+};
+
+TEST_F(FocusFrames, IntactFrameIsStoredAtItsOffset) {
+  BufferStream stream(frame(4, {1, 2, 3}));
+
+  EXPECT_TRUE(::Focus.readFrame(stream, storage_base, max_length));
+
+  std::vector<uint8_t> expected = untouched();
+  expected[4] = 1;
+  expected[5] = 2;
+  expected[6] = 3;
+  EXPECT_THAT(stored(), ::testing::ElementsAreArray(expected));
+  EXPECT_EQ(stream.available(), 0);
+}
+
+TEST_F(FocusFrames, BadChecksumLeavesStorageUntouched) {
+  std::vector<uint8_t> data = frame(0, {1, 2, 3, 4, 5, 6, 7, 8});
+  data.back() ^= 0x01;
+  BufferStream stream(data);
+
+  EXPECT_FALSE(::Focus.readFrame(stream, storage_base, max_length));
+  EXPECT_THAT(stored(), ::testing::ElementsAreArray(untouched()));
+  EXPECT_EQ(stream.available(), 0);
+}
+
+TEST_F(FocusFrames, CorruptPayloadLeavesStorageUntouched) {
+  std::vector<uint8_t> data = frame(0, {1, 2, 3, 4, 5, 6, 7, 8});
+  data[7] ^= 0x10;
+  BufferStream stream(data);
+
+  EXPECT_FALSE(::Focus.readFrame(stream, storage_base, max_length));
+  EXPECT_THAT(stored(), ::testing::ElementsAreArray(untouched()));
+}
+
+TEST_F(FocusFrames, FrameOutOfBoundsIsRefused) {
+  // Intact, but it would write past `max_length`. It is still read to its
+  // end, so that it is not taken for the next command.
+  BufferStream stream(frame(max_length - 2, {1, 2, 3}));
+
+  EXPECT_FALSE(::Focus.readFrame(stream, storage_base, max_length));
+  EXPECT_THAT(stored(), ::testing::ElementsAreArray(untouched()));
+  EXPECT_EQ(stream.available(), 0);
+}
+
+TEST_F(FocusFrames, FrameLongerThanTheBufferIsRefused) {
+  std::vector<uint8_t> payload(FOCUS_SERIAL_MAX_FRAME_LENGTH + 1, 0x55);
+  BufferStream stream(frame(0, payload));
+
+  EXPECT_FALSE(::Focus.readFrame(stream, storage_base, 0xffff));
+  EXPECT_THAT(stored(), ::testing::ElementsAreArray(untouched()));
+  EXPECT_EQ(stream.available(), 0);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
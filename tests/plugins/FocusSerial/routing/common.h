@@ -0,0 +1,35 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace kaleidoscope {
+namespace testing {
+
+// The plugin of the sketch that consumed the last Focus command.
+enum class FocusHandler : uint8_t {
+  NONE,
+  SHARED_FIRST,
+  SHARED_SECOND,
+  OTHER,
+};
+
+extern FocusHandler last_focus_handler;
+
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,106 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Kaleidoscope.h>
+#include <Kaleidoscope-FocusSerial.h>
+
+#include "./common.h"
+
+// *INDENT-OFF*
+KEYMAPS(
+    [0] = KEYMAP_STACKED
+    (
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___,
+        ___,
+
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___,
+        ___
+    ),
+)
+// *INDENT-ON*
+
+namespace kaleidoscope {
+namespace testing {
+
+FocusHandler last_focus_handler = FocusHandler::NONE;
+
+// Lists a single command, but claims everything under its prefix.
+class SharedFirst : public kaleidoscope::Plugin {
+ public:
+  EventHandlerResult onFocusEvent(const char *command) {
+    if (::Focus.handleHelp(command, PSTR("shared.first")))
+      return EventHandlerResult::OK;
+
+    if (strncmp_P(command, PSTR("shared."), 7) != 0)
+      return EventHandlerResult::OK;
+
+    last_focus_handler = FocusHandler::SHARED_FIRST;
+    return EventHandlerResult::EVENT_CONSUMED;
+  }
+};
+
+class SharedSecond : public kaleidoscope::Plugin {
+ public:
+  EventHandlerResult onFocusEvent(const char *command) {
+    if (::Focus.handleHelp(command, PSTR("shared.second")))
+      return EventHandlerResult::OK;
+
+    if (strcmp_P(command, PSTR("shared.second")) != 0)
+      return EventHandlerResult::OK;
+
+    last_focus_handler = FocusHandler::SHARED_SECOND;
+    return EventHandlerResult::EVENT_CONSUMED;
+  }
+};
+
+class Other : public kaleidoscope::Plugin {
+ public:
+  EventHandlerResult onFocusEvent(const char *command) {
+    if (::Focus.handleHelp(command, PSTR("other.command")))
+      return EventHandlerResult::OK;
+
+    if (strcmp_P(command, PSTR("other.command")) != 0)
+      return EventHandlerResult::OK;
+
+    last_focus_handler = FocusHandler::OTHER;
+    return EventHandlerResult::EVENT_CONSUMED;
+  }
+};
+
+}  // namespace testing
+}  // namespace kaleidoscope
+
+kaleidoscope::testing::SharedFirst SharedFirst;
+kaleidoscope::testing::SharedSecond SharedSecond;
+kaleidoscope::testing::Other Other;
+
+KALEIDOSCOPE_INIT_PLUGINS(Focus, SharedFirst, SharedSecond, Other);
+
+void setup() {
+  Kaleidoscope.setup();
+}
+
+void loop() {
+  Kaleidoscope.loop();
+}
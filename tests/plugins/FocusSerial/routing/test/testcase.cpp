@@ -0,0 +1,52 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testing/setup-googletest.h"
+#include "Kaleidoscope-FocusSerial.h"
+
+#include "../common.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+class FocusRouting : public VirtualDeviceTest {
+ public:
+  FocusHandler dispatch(const char *command) {
+    last_focus_handler = FocusHandler::NONE;
+    ::Focus.dispatch(command);
+    return last_focus_handler;
+  }
+};
+
+// Both plugins list a command under "shared.", so the first one in the chain
+// must still see "shared.second" before the plugin that lists it.
+TEST_F(FocusRouting, SharedPrefixKeepsChainOrder) {
+  EXPECT_EQ(dispatch("shared.second"), FocusHandler::SHARED_FIRST);
+  EXPECT_EQ(dispatch("shared.first"), FocusHandler::SHARED_FIRST);
+  EXPECT_EQ(dispatch("shared.unlisted"), FocusHandler::SHARED_FIRST);
+}
+
+TEST_F(FocusRouting, UniquePrefixIsRouted) {
+  EXPECT_EQ(dispatch("other.command"), FocusHandler::OTHER);
+  EXPECT_EQ(dispatch("other.unknown"), FocusHandler::NONE);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
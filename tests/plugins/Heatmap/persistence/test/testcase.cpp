@@ -0,0 +1,126 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kaleidoscope-LEDControl.h"
+#include "Kaleidoscope-Heatmap.h"
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr KeyAddr addr_A{0, 0};
+constexpr KeyAddr addr_B{0, 1};
+
+constexpr uint8_t led_off_mode = 0;
+constexpr uint8_t heatmap_mode = 1;
+
+class PersistentHeatmap : public VirtualDeviceTest {
+ protected:
+  void SetUp() {
+    VirtualDeviceTest::SetUp();
+    ::LEDControl.set_mode(heatmap_mode);
+    ::PersistentHeatmapEffect.resetMap();
+  }
+
+  void TearDown() {
+    plugin::Heatmap::decay_delay = 0;
+    plugin::PersistentHeatmap::save_delay = 600;
+  }
+
+  void tap(KeyAddr key_addr, int times = 1) {
+    for (int i = 0; i < times; i++) {
+      sim_.Press(key_addr);
+      RunCycle();
+      sim_.Release(key_addr);
+      RunCycle();
+    }
+  }
+
+  // Waits for the next heatmap update, which recolors the keys. LED modes are
+  // only updated every `syncDelay` milliseconds.
+  void update() {
+    sim_.RunForMillis(plugin::Heatmap::update_delay + ::LEDControl.syncDelay + 1);
+  }
+
+  std::vector<uint8_t> storage() {
+    std::vector<uint8_t> contents;
+    for (uint16_t i = 0; i < Runtime.storage().length(); i++)
+      contents.push_back(Runtime.storage().read(i));
+    return contents;
+  }
+
+  bool isBlack(KeyAddr key_addr) {
+    cRGB color = ::LEDControl.getCrgbAt(key_addr);
+    return color.r == 0 && color.g == 0 && color.b == 0;
+  }
+
+  bool isHottest(KeyAddr key_addr) {
+    const cRGB &hottest =
+      plugin::Heatmap::heat_colors[plugin::Heatmap::heat_colors_length - 1];
+    cRGB color = ::LEDControl.getCrgbAt(key_addr);
+    return color.r == hottest.r && color.g == hottest.g && color.b == hottest.b;
+  }
+};
+
+TEST_F(PersistentHeatmap, CountsAreSavedWhenSwitchingAway) {
+  tap(addr_A, 3);
+  tap(addr_B);
+
+  // The heatmap's counts go away with the mode, and are loaded back from
+  // storage when it is activated again.
+  ::LEDControl.set_mode(led_off_mode);
+  RunCycle();
+  ::LEDControl.set_mode(heatmap_mode);
+
+  EXPECT_TRUE(isHottest(addr_A));
+  EXPECT_FALSE(isBlack(addr_B));
+  EXPECT_FALSE(isHottest(addr_B));
+}
+
+TEST_F(PersistentHeatmap, CountsAreSavedPeriodically) {
+  plugin::PersistentHeatmap::save_delay = 1;
+  sim_.RunForMillis(1001);
+
+  auto saved = storage();
+  tap(addr_A);
+  EXPECT_EQ(storage(), saved);
+
+  sim_.RunForMillis(1001);
+  EXPECT_NE(storage(), saved);
+}
+
+TEST_F(PersistentHeatmap, DecayHalvesTheCounts) {
+  tap(addr_A, 4);
+  tap(addr_B);
+  update();
+  EXPECT_TRUE(isHottest(addr_A));
+  EXPECT_FALSE(isBlack(addr_B));
+
+  // A single press of B decays to nothing.
+  plugin::Heatmap::decay_delay = 1;
+  sim_.RunForMillis(1001);
+  update();
+  EXPECT_TRUE(isHottest(addr_A));
+  EXPECT_TRUE(isBlack(addr_B));
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
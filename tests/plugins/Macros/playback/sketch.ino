@@ -0,0 +1,75 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Kaleidoscope.h>
+#include <Kaleidoscope-Macros.h>
+
+// *INDENT-OFF*
+KEYMAPS(
+  [0] = KEYMAP_STACKED
+  (
+      M(0), M(1), M(2), M(3), M(4), ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+
+      ___, ___, ___, ___,
+      ___,
+
+      ___, ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+           ___, ___, ___, ___, ___, ___,
+      ___, ___, ___, ___, ___, ___, ___,
+
+      ___, ___, ___, ___,
+      ___
+   ),
+)
+// *INDENT-ON*
+
+const macro_t *macroAction(uint8_t index, uint8_t keyState) {
+  switch (index) {
+  case 0:
+    return MACRODOWN(D(LeftShift), T(A), U(LeftShift), T(B));
+  case 1:
+    return MACRODOWN(WITH_EXPLICIT_REPORT,
+                     D(A), D(B), SEND_REPORT,
+                     U(A), SEND_REPORT,
+                     U(B), SEND_REPORT);
+  case 2:
+    return MACRODOWN(I(10), T(A), W(20), T(B));
+  case 3:
+    if (keyToggledOn(keyState))
+      return Macros.type("Hi");
+    break;
+  case 4:
+    // One more string than the queue holds.
+    if (keyToggledOn(keyState))
+      return Macros.type("a", "b", "c", "d", "e", "f", "g", "h", "i");
+    break;
+  }
+  return MACRO_NONE;
+}
+
+KALEIDOSCOPE_INIT_PLUGINS(Macros);
+
+void setup() {
+  Kaleidoscope.setup();
+}
+
+void loop() {
+  Kaleidoscope.loop();
+}
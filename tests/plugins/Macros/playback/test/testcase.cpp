@@ -0,0 +1,171 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kaleidoscope-Macros.h"
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr KeyAddr addr_implicit{0, 0};
+constexpr KeyAddr addr_explicit{0, 1};
+constexpr KeyAddr addr_timed{0, 2};
+constexpr KeyAddr addr_type{0, 3};
+constexpr KeyAddr addr_overflow{0, 4};
+
+typedef std::set<uint8_t> KeycodeSet;
+
+class MacrosPlayback : public VirtualDeviceTest {
+ protected:
+  // The keycodes of every report sent, and when they were sent.
+  std::vector<KeycodeSet> reports_;
+  std::vector<uint32_t> timestamps_;
+
+  void collect(const std::unique_ptr<State> &state) {
+    for (auto &report : state->HIDReports()->Keyboard()) {
+      auto keycodes = report.ActiveKeycodes();
+      reports_.push_back(KeycodeSet(keycodes.begin(), keycodes.end()));
+      timestamps_.push_back(report.Timestamp());
+    }
+  }
+
+  // Runs cycles until the macros are done playing, and returns how many it
+  // took.
+  int finish() {
+    int cycles = 0;
+
+    while (::Macros.busy() && cycles < 1000) {
+      collect(RunCycle());
+      cycles++;
+    }
+    return cycles;
+  }
+
+  // Taps the macro key, and runs cycles until the macros are done playing.
+  // Returns the number of cycles it took.
+  int play(KeyAddr key_addr) {
+    sim_.Press(key_addr);
+    collect(RunCycle());
+    sim_.Release(key_addr);
+    return 1 + finish();
+  }
+};
+
+TEST_F(MacrosPlayback, ImplicitReportsOneEventPerCycle) {
+  play(addr_implicit);
+
+  uint8_t shift = Key_LeftShift.getKeyCode();
+  uint8_t a = Key_A.getKeyCode();
+  uint8_t b = Key_B.getKeyCode();
+  std::vector<KeycodeSet> expected = {
+    {shift},     // D(LeftShift)
+    {shift, a},  // T(A), first half: the held shift is still pressed
+    {shift},     // T(A), second half
+    {},          // U(LeftShift)
+    {b},         // T(B), first half
+    {},          // T(B), second half
+  };
+  EXPECT_THAT(reports_, ::testing::ElementsAreArray(expected));
+
+  // One report per cycle, so the keyboard keeps scanning in between.
+  for (size_t i = 1; i < timestamps_.size(); i++)
+    EXPECT_EQ(timestamps_[i], timestamps_[i - 1] + sim_.CycleTime())
+        << "Report " << i << " should be sent on the cycle after the previous one";
+}
+
+TEST_F(MacrosPlayback, ExplicitReportsWaitForSendReport) {
+  play(addr_explicit);
+
+  uint8_t a = Key_A.getKeyCode();
+  uint8_t b = Key_B.getKeyCode();
+  std::vector<KeycodeSet> expected = {
+    // D(A), D(B), SEND_REPORT: the keyboard driver sends the report without
+    // the key toggled on last first, as it does for physical keys.
+    {a},
+    {a, b},
+    {b},     // U(A), SEND_REPORT: B is pressed again, as it is held
+    {},      // U(B), SEND_REPORT
+  };
+  EXPECT_THAT(reports_, ::testing::ElementsAreArray(expected));
+}
+
+TEST_F(MacrosPlayback, IntervalsAndWaitsAreTimers) {
+  int cycles = play(addr_timed);
+
+  uint8_t a = Key_A.getKeyCode();
+  uint8_t b = Key_B.getKeyCode();
+  std::vector<KeycodeSet> expected = {{a}, {}, {b}, {}};
+  ASSERT_THAT(reports_, ::testing::ElementsAreArray(expected));
+
+  // The interval follows the second half of each tap, and the wait comes on
+  // top of it. The cycles keep running in the meantime.
+  EXPECT_EQ(timestamps_[1] - timestamps_[0], sim_.CycleTime());
+  EXPECT_GE(timestamps_[2] - timestamps_[1], 10 + 20);
+  EXPECT_LE(timestamps_[2] - timestamps_[1], 10 + 20 + 2 * sim_.CycleTime());
+  EXPECT_EQ(timestamps_[3] - timestamps_[2], sim_.CycleTime());
+  EXPECT_GT(cycles, 10 + 20);
+}
+
+TEST_F(MacrosPlayback, TypeTapsEachCharacter) {
+  play(addr_type);
+
+  uint8_t shift = Key_LeftShift.getKeyCode();
+  uint8_t h = Key_H.getKeyCode();
+  uint8_t i = Key_I.getKeyCode();
+  // The shift of `H` is pressed in a report of its own before it, and released
+  // in one after it, as with a physical `LSHIFT(Key_H)`.
+  std::vector<KeycodeSet> expected = {
+    {shift}, {shift, h}, {shift}, {},
+    {i}, {},
+  };
+  EXPECT_THAT(reports_, ::testing::ElementsAreArray(expected));
+}
+
+TEST_F(MacrosPlayback, QueueOverflowFlushes) {
+  sim_.Press(addr_overflow);
+  auto state = RunCycle();
+  collect(state);
+
+  // The ninth string doesn't fit in the queue: the first eight are played
+  // right away, within the same cycle, and the ninth one is queued.
+  std::vector<KeycodeSet> expected;
+  for (char c = 'a'; c <= 'h'; c++) {
+    expected.push_back({static_cast<uint8_t>(Key_A.getKeyCode() + c - 'a')});
+    expected.push_back({});
+  }
+  expected.push_back({Key_I.getKeyCode()});
+  EXPECT_THAT(reports_, ::testing::ElementsAreArray(expected));
+  for (auto timestamp : timestamps_)
+    EXPECT_EQ(timestamp, timestamps_[0]);
+
+  sim_.Release(addr_overflow);
+  collect(RunCycle());
+  finish();
+  EXPECT_THAT(reports_.back(), ::testing::IsEmpty());
+
+  // Nothing is left to play.
+  size_t count = reports_.size();
+  collect(RunCycle());
+  EXPECT_EQ(reports_.size(), count);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
@@ -0,0 +1,78 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Kaleidoscope.h>
+#include <Kaleidoscope-MagicCombo.h>
+
+// *INDENT-OFF*
+KEYMAPS(
+    [0] = KEYMAP_STACKED
+    (
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___,
+        ___,
+
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___, ___, ___, ___,
+        ___, ___, ___, ___,
+        ___
+    ),
+)
+// *INDENT-ON*
+
+void tapKeyA(uint8_t magic_combo_index) {
+  handleKeyswitchEvent(Key_A, KeyAddr{1, 0}, IS_PRESSED | INJECTED);
+  Kaleidoscope.hid().keyboard().sendReport();
+  handleKeyswitchEvent(Key_NoKey, KeyAddr{1, 0}, WAS_PRESSED | INJECTED);
+  Kaleidoscope.hid().keyboard().sendReport();
+}
+
+USE_MAGIC_COMBOS({.action = tapKeyA, .keys = {R0C0, R0C1}});
+
+namespace kaleidoscope {
+namespace plugin {
+
+// Consumes every key event of the top left key, so that MagicCombo, which
+// comes after it, never sees that key toggle.
+class SwallowTopLeft : public kaleidoscope::Plugin {
+ public:
+  EventHandlerResult onKeyswitchEvent(Key &mapped_key, KeyAddr key_addr, uint8_t key_state) {
+    if (key_addr == KeyAddr{0, 0})
+      return EventHandlerResult::EVENT_CONSUMED;
+    return EventHandlerResult::OK;
+  }
+};
+
+}
+}
+
+kaleidoscope::plugin::SwallowTopLeft SwallowTopLeft;
+
+KALEIDOSCOPE_INIT_PLUGINS(SwallowTopLeft, MagicCombo);
+
+void setup() {
+  Kaleidoscope.setup();
+  MagicCombo.min_interval = 20;
+}
+
+void loop() {
+  Kaleidoscope.loop();
+}
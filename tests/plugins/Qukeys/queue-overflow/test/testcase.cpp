@@ -0,0 +1,108 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kaleidoscope-Qukeys.h"
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+constexpr KeyAddr key_addr_A{2, 1};
+
+// Keys pressed while the qukey is held: more of them than the queue can hold
+// behind it.
+const KeyAddr rolled_over[] = {
+  {1, 1}, {1, 2}, {1, 3}, {1, 4}, {1, 5},
+  {3, 1}, {3, 2}, {3, 3}, {3, 4}, {3, 5},
+};
+const Key rolled_over_keys[] = {
+  Key_Q, Key_W, Key_E, Key_R, Key_T,
+  Key_Z, Key_X, Key_C, Key_V, Key_B,
+};
+
+constexpr size_t rolled_over_count = sizeof(rolled_over) / sizeof(*rolled_over);
+
+static_assert(rolled_over_count > QUKEYS_QUEUE_CAPACITY,
+              "The test must roll over more keys than the queue holds");
+
+class QukeysQueueOverflow : public VirtualDeviceTest {
+ protected:
+  // The keycodes each report added, in order.
+  std::vector<uint8_t> added_;
+  std::set<uint8_t> held_;
+
+  void collect(const std::unique_ptr<State> &state) {
+    for (auto &report : state->HIDReports()->Keyboard()) {
+      std::set<uint8_t> now;
+      for (uint8_t keycode : report.ActiveKeycodes()) {
+        now.insert(keycode);
+        if (held_.count(keycode) == 0)
+          added_.push_back(keycode);
+      }
+      held_ = now;
+    }
+  }
+};
+
+TEST_F(QukeysQueueOverflow, RollOverMoreKeysThanTheQueueHolds) {
+  ::Qukeys.resetQueueStats();
+
+  sim_.Press(key_addr_A);
+  collect(RunCycle());
+  for (size_t i = 0; i < rolled_over_count; i++) {
+    sim_.Press(rolled_over[i]);
+    collect(RunCycle());
+
+    // The queue overflows once, when the qukey and the keys rolled over so far
+    // fill it, and not again after the qukey was flushed.
+    size_t queued = i + 2;
+    EXPECT_EQ(::Qukeys.queueOverflows(), queued >= QUKEYS_QUEUE_CAPACITY ? 1 : 0)
+        << "after rolling over " << i + 1 << " keys";
+  }
+
+  // The full queue resolves the qukey to its primary value, before its hold
+  // timeout, and the other keys follow in the order they were pressed.
+  for (int i = 0; i < QUKEYS_QUEUE_CAPACITY; i++)
+    collect(RunCycle());
+
+  std::vector<uint8_t> expected = {Key_A.getKeyCode()};
+  for (Key key : rolled_over_keys)
+    expected.push_back(key.getKeyCode());
+  EXPECT_THAT(added_, ::testing::ElementsAreArray(expected));
+
+  EXPECT_EQ(::Qukeys.queueOverflows(), 1);
+  EXPECT_EQ(::Qukeys.maxQueueLength(), QUKEYS_QUEUE_CAPACITY);
+
+  sim_.Release(key_addr_A);
+  for (auto key_addr : rolled_over)
+    sim_.Release(key_addr);
+  for (int i = 0; i < 2 * QUKEYS_QUEUE_CAPACITY; i++)
+    collect(RunCycle());
+
+  EXPECT_THAT(held_, ::testing::IsEmpty());
+
+  ::Qukeys.resetQueueStats();
+  EXPECT_EQ(::Qukeys.queueOverflows(), 0);
+  EXPECT_EQ(::Qukeys.maxQueueLength(), 0);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope
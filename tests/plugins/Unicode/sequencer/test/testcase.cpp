@@ -0,0 +1,150 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2020  Keyboard.io, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kaleidoscope-HostOS.h"
+#include "Kaleidoscope-Unicode.h"
+
+#include "testing/setup-googletest.h"
+
+SETUP_GOOGLETEST();
+
+namespace kaleidoscope {
+namespace testing {
+namespace {
+
+typedef std::set<uint8_t> KeycodeSet;
+
+class UnicodeSequencer : public VirtualDeviceTest {
+ protected:
+  // The keycodes of every report sent, and when they were sent.
+  std::vector<KeycodeSet> reports_;
+  std::vector<uint32_t> timestamps_;
+
+  void collect(const std::unique_ptr<State> &state) {
+    for (auto &report : state->HIDReports()->Keyboard()) {
+      auto keycodes = report.ActiveKeycodes();
+      reports_.push_back(KeycodeSet(keycodes.begin(), keycodes.end()));
+      timestamps_.push_back(report.Timestamp());
+    }
+  }
+
+  // Runs cycles until the queue is empty, and returns how many it took.
+  int finish() {
+    int cycles = 0;
+
+    while (::Unicode.busy() && cycles < 1000) {
+      collect(RunCycle());
+      cycles++;
+    }
+    return cycles;
+  }
+
+  // The reports that type U+00E9 (é) on Linux.
+  std::vector<KeycodeSet> linuxReports(uint8_t last_digit) {
+    uint8_t ctrl = Key_LeftControl.getKeyCode();
+    uint8_t shift = Key_LeftShift.getKeyCode();
+    return {
+      // Ctrl+Shift+U: the modifiers are pressed before the key, and released
+      // after it
+      {ctrl, shift}, {ctrl, shift, Key_U.getKeyCode()}, {ctrl, shift}, {},
+      // at least four digits, each tapped
+      {Key_0.getKeyCode()}, {},
+      {Key_0.getKeyCode()}, {},
+      {Key_E.getKeyCode()}, {},
+      {last_digit}, {},
+      // and a space to end it
+      {Key_Spacebar.getKeyCode()}, {},
+    };
+  }
+};
+
+TEST_F(UnicodeSequencer, Linux) {
+  ::HostOS.os(hostos::LINUX);
+  ::Unicode.type(0xe9);
+  int cycles = finish();
+
+  EXPECT_THAT(reports_, ::testing::ElementsAreArray(linuxReports(Key_9.getKeyCode())));
+
+  // The digits are 5ms apart, and the keyboard keeps scanning in between.
+  ASSERT_EQ(timestamps_.size(), 14);
+  EXPECT_EQ(timestamps_[4], timestamps_[3] + sim_.CycleTime());
+  for (int i = 6; i <= 12; i += 2)
+    EXPECT_EQ(timestamps_[i] - timestamps_[i - 1], 5)
+        << "Report " << i << " should be sent 5ms after the previous one";
+  EXPECT_GT(cycles, 5 * 5);
+}
+
+TEST_F(UnicodeSequencer, WindowsMoreThanFourDigits) {
+  ::HostOS.os(hostos::WINDOWS);
+  ::Unicode.type(0x1f600);
+  finish();
+
+  // Alt is held all along, and the digits are typed on the keypad, but for
+  // the letters.
+  uint8_t alt = Key_LeftAlt.getKeyCode();
+  std::vector<KeycodeSet> expected = {
+    {alt}, {alt, Key_KeypadAdd.getKeyCode()}, {alt},
+    {alt, Key_Keypad1.getKeyCode()}, {alt},
+    {alt, Key_F.getKeyCode()}, {alt},
+    {alt, Key_Keypad6.getKeyCode()}, {alt},
+    {alt, Key_Keypad0.getKeyCode()}, {alt},
+    {alt, Key_Keypad0.getKeyCode()}, {alt},
+    {},
+  };
+  EXPECT_THAT(reports_, ::testing::ElementsAreArray(expected));
+}
+
+TEST_F(UnicodeSequencer, FlushTypesTheQueueRightAway) {
+  ::HostOS.os(hostos::LINUX);
+  ::Unicode.type(0xe9);
+  ::Unicode.type(0xe8);
+  ::Unicode.flush();
+  EXPECT_FALSE(::Unicode.busy());
+
+  collect(RunCycle());
+
+  std::vector<KeycodeSet> expected = linuxReports(Key_9.getKeyCode());
+  std::vector<KeycodeSet> second = linuxReports(Key_8.getKeyCode());
+  expected.insert(expected.end(), second.begin(), second.end());
+  EXPECT_THAT(reports_, ::testing::ElementsAreArray(expected));
+}
+
+TEST_F(UnicodeSequencer, QueueOverflowFlushes) {
+  ::HostOS.os(hostos::LINUX);
+  for (int i = 0; i < UNICODE_QUEUE_SIZE + 1; i++)
+    ::Unicode.type(0xe9);
+
+  // The code points that filled the queue are typed right away when one more
+  // is queued, and only that one is left to type on the following cycles.
+  EXPECT_TRUE(::Unicode.busy());
+  finish();
+
+  std::vector<KeycodeSet> expected;
+  for (int i = 0; i < UNICODE_QUEUE_SIZE + 1; i++) {
+    std::vector<KeycodeSet> one = linuxReports(Key_9.getKeyCode());
+    expected.insert(expected.end(), one.begin(), one.end());
+  }
+  ASSERT_THAT(reports_, ::testing::ElementsAreArray(expected));
+
+  size_t flushed = UNICODE_QUEUE_SIZE * 14;
+  for (size_t i = 1; i < flushed; i++)
+    EXPECT_EQ(timestamps_[i], timestamps_[0]);
+  EXPECT_GT(timestamps_.back(), timestamps_[flushed]);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace kaleidoscope